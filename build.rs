@@ -8,7 +8,7 @@ fn main() {
     let dest = env::var("OUT_DIR").unwrap();
     let mut file = File::create(Path::new(&dest).join("gl_bindings.rs")).unwrap();
 
-    Registry::new(Api::Gles2, (2, 0), Profile::Core, Fallbacks::All, [])
+    Registry::new(Api::Gles2, (2, 0), Profile::Core, Fallbacks::All, ["GL_OES_EGL_image"])
         .write_bindings(GlobalGenerator, &mut file)
         .unwrap();
 }
@@ -0,0 +1,95 @@
+// Defer loading of offscreen images and iframes.
+//
+// This runs at document start, updating elements as the parser inserts them.
+//
+// Since mutation observers only run after insertion, elements have already
+// started loading by the time they are updated. The loads of elements inserted
+// by the parser are restarted, so WebKit can defer them if they are offscreen.
+// Requests started by WebKit's preload scanner before the parser reaches an
+// element cannot be deferred.
+(() => {
+    // Check whether an iframe is still waiting for its network document.
+    //
+    // Until then, it shows its initial empty document, which scripts might
+    // have written to already.
+    const pendingFrame = (iframe) => {
+        const src = iframe.getAttribute("src");
+        if (!src || iframe.hasAttribute("srcdoc")) {
+            return false;
+        }
+        let protocol;
+        try {
+            protocol = new URL(src, document.baseURI).protocol;
+        } catch {
+            return false;
+        }
+        if (protocol !== "http:" && protocol !== "https:") {
+            return false;
+        }
+
+        const frameDocument = iframe.contentDocument;
+        return frameDocument?.URL === "about:blank" && !frameDocument.body?.hasChildNodes();
+    };
+
+    // Restart an element's load, honoring its new loading attribute.
+    //
+    // Only elements inserted while the document is parsed are restarted, to
+    // avoid interfering with elements managed by scripts.
+    const restart = (element) => {
+        if (document.readyState !== "loading") {
+            return;
+        }
+
+        if (element.tagName === "IFRAME") {
+            // Reinserting an iframe cancels its navigation.
+            if (pendingFrame(element)) {
+                element.parentNode?.insertBefore(element, element.nextSibling);
+            }
+        } else if (
+            !element.complete
+            && element.hasAttribute("src")
+            && !element.hasAttribute("srcset")
+            && element.parentElement?.tagName !== "PICTURE"
+        ) {
+            // Removing the source cancels the request, unless it is still used
+            // by another element. Responsive images keep loading their
+            // selected source, so they are left alone.
+            const src = element.getAttribute("src");
+            element.removeAttribute("src");
+            element.setAttribute("src", src);
+        }
+    };
+
+    const update = (element) => {
+        if (element.tagName === "IMG" && !element.hasAttribute("decoding")) {
+            element.setAttribute("decoding", "async");
+        }
+        if (!element.hasAttribute("loading")) {
+            element.setAttribute("loading", "lazy");
+            restart(element);
+        }
+    };
+
+    const updateTree = (node) => {
+        if (node.nodeType !== Node.ELEMENT_NODE) {
+            return;
+        }
+
+        if (node.tagName === "IMG" || node.tagName === "IFRAME") {
+            update(node);
+        }
+        for (const element of node.querySelectorAll("img, iframe")) {
+            update(element);
+        }
+    };
+
+    const observer = new MutationObserver((mutations) => {
+        for (const mutation of mutations) {
+            mutation.addedNodes.forEach(updateTree);
+        }
+    });
+    observer.observe(document, { childList: true, subtree: true });
+
+    // Stop observing once the page is loaded, to avoid slowing down DOM updates.
+    window.addEventListener("load", () => observer.disconnect(), { once: true });
+})();
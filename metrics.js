@@ -0,0 +1,53 @@
+// Report page load performance metrics.
+//
+// This runs in an isolated world, so pages cannot send fake reports.
+(() => {
+    // Delay after the load event before reporting, to let the LCP settle.
+    const REPORT_DELAY_MS = 5000;
+
+    let firstContentfulPaint = null;
+    let largestContentfulPaint = null;
+
+    const observe = (type, callback) => {
+        if (!PerformanceObserver.supportedEntryTypes.includes(type)) {
+            return;
+        }
+        const observer = new PerformanceObserver((list) => list.getEntries().forEach(callback));
+        observer.observe({ type, buffered: true });
+    };
+    observe("paint", (entry) => {
+        if (entry.name === "first-contentful-paint") {
+            firstContentfulPaint = entry.startTime;
+        }
+    });
+    observe("largest-contentful-paint", (entry) => {
+        largestContentfulPaint = entry.startTime;
+    });
+
+    let reported = false;
+    const report = () => {
+        const [navigation] = performance.getEntriesByType("navigation");
+        if (reported || !navigation) {
+            return;
+        }
+        reported = true;
+
+        window.webkit.messageHandlers.pageMetrics.postMessage({
+            uri: location.href,
+            responseStart: navigation.responseStart,
+            domContentLoaded: navigation.domContentLoadedEventEnd,
+            load: navigation.loadEventEnd,
+            firstContentfulPaint,
+            largestContentfulPaint,
+        });
+    };
+
+    // Report once the page is hidden, or shortly after it has finished loading.
+    window.addEventListener("pagehide", report);
+    document.addEventListener("visibilitychange", () => {
+        if (document.visibilityState === "hidden") {
+            report();
+        }
+    });
+    window.addEventListener("load", () => setTimeout(report, REPORT_DELAY_MS));
+})();
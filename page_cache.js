@@ -0,0 +1,18 @@
+// Report whether back/forward navigations were restored from the page cache.
+//
+// This runs in an isolated world, so pages cannot send fake reports.
+(() => {
+    window.addEventListener("pageshow", (event) => {
+        const handlers = window.webkit.messageHandlers;
+
+        if (event.persisted) {
+            handlers.pageCacheRestored.postMessage("");
+            return;
+        }
+
+        const [navigation] = performance.getEntriesByType("navigation");
+        if (navigation && navigation.type === "back_forward") {
+            handlers.pageCacheReloaded.postMessage("");
+        }
+    });
+})();
@@ -0,0 +1,63 @@
+// Report pinch zoom state, for previewing pinch gestures in the browser.
+//
+// This runs in an isolated world, so pages cannot send fake reports.
+(() => {
+    const handlers = window.webkit.messageHandlers;
+
+    // Check whether the viewport meta tag allows zooming.
+    const zoomable = () => {
+        const meta = document.querySelector("meta[name=viewport]");
+        if (!meta) {
+            return true;
+        }
+
+        const content = meta.content.toLowerCase().replace(/\s/g, "");
+        const value = (name) => {
+            const match = new RegExp(`(^|[,;])${name}=([^,;]*)`).exec(content);
+            return match ? match[2] : null;
+        };
+
+        const userScalable = value("user-scalable");
+        if (userScalable === "no" || userScalable === "0") {
+            return false;
+        }
+
+        const minScale = parseFloat(value("minimum-scale"));
+        const maxScale = parseFloat(value("maximum-scale"));
+        return !(minScale >= maxScale);
+    };
+
+    // Check whether an element's touch-action leaves pinch zoom to the browser.
+    const browserZoom = (element) => {
+        for (let node = element; node instanceof Element; node = node.parentElement) {
+            const action = getComputedStyle(node).touchAction;
+            if (action !== "auto" && action !== "manipulation" && !action.includes("pinch-zoom")) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const reportZoomable = () => handlers.pinchPreview.postMessage(zoomable());
+    document.addEventListener("DOMContentLoaded", reportZoomable);
+
+    // Pages handling two finger gestures themselves cannot be previewed.
+    //
+    // The check is deferred until all page listeners had a chance to cancel
+    // the event.
+    window.addEventListener("touchstart", (event) => {
+        if (event.touches.length !== 2) {
+            return;
+        }
+
+        setTimeout(() => {
+            const previewable = !event.defaultPrevented && browserZoom(event.target) && zoomable();
+            handlers.pinchPreview.postMessage(previewable);
+        });
+    });
+
+    // Report page scale changes, so the preview ends once they are rendered.
+    window.visualViewport?.addEventListener("resize", () => {
+        handlers.pageScale.postMessage(window.visualViewport.scale);
+    });
+})();
@@ -0,0 +1,435 @@
+//! Automated page load benchmarks.
+//!
+//! Benchmarks serve a bundled corpus of static pages from a local HTTP server
+//! and load each of them in the active tab, reporting load times, memory
+//! usage, and rendered frames. The corpus is loaded twice, with lazy loading
+//! toggled between passes, to compare both configurations.
+//!
+//! Afterwards, the corpus is opened in [`MULTI_TAB_COUNT`] new tabs, to
+//! measure the effects of web process sharing.
+
+use std::io::{self, BufRead, BufReader, Write};
+use std::net::{Ipv4Addr, TcpListener, TcpStream};
+use std::path::PathBuf;
+use std::time::{Duration, Instant};
+use std::{env, fs, process, thread};
+
+use glib::{source, SourceId};
+use tracing::{error, info, warn};
+
+use crate::engine::EngineId;
+use crate::{memory, State};
+
+/// Number of times every page is loaded.
+const ITERATIONS: usize = 3;
+
+/// Time to wait after a load has finished, to let rendering settle.
+const SETTLE_DELAY: Duration = Duration::from_millis(500);
+
+/// Maximum time for a single page load.
+const LOAD_TIMEOUT: Duration = Duration::from_secs(30);
+
+/// Number of tabs opened by the multi-tab scenario.
+const MULTI_TAB_COUNT: usize = 8;
+
+/// Pages loaded by the benchmark.
+const PAGES: &[&str] = &[
+    "/article.html",
+    "/gallery.html",
+    "/photos.html",
+    "/scripted.html",
+    "/frames.html",
+    "/embeds.html",
+];
+
+/// Benchmark corpus, as path, content type, and body.
+const FIXTURES: &[(&str, &str, &[u8])] = &[
+    ("/article.html", "text/html", include_bytes!("../benchmark/article.html")),
+    ("/embed.html", "text/html", include_bytes!("../benchmark/embed.html")),
+    ("/embeds.html", "text/html", include_bytes!("../benchmark/embeds.html")),
+    ("/frames.html", "text/html", include_bytes!("../benchmark/frames.html")),
+    ("/gallery.html", "text/html", include_bytes!("../benchmark/gallery.html")),
+    ("/image.svg", "image/svg+xml", include_bytes!("../benchmark/image.svg")),
+    ("/photo.png", "image/png", include_bytes!("../benchmark/photo.png")),
+    ("/photos.html", "text/html", include_bytes!("../benchmark/photos.html")),
+    ("/scripted.html", "text/html", include_bytes!("../benchmark/scripted.html")),
+    ("/style.css", "text/css", include_bytes!("../benchmark/style.css")),
+];
+
+#[funq::callbacks(State)]
+pub trait BenchmarkHandler {
+    /// Load the next benchmark page, or report results once all are done.
+    fn load_next_benchmark_page(&mut self);
+
+    /// Record the result of the current benchmark page.
+    fn finish_benchmark_page(&mut self);
+}
+
+impl BenchmarkHandler for State {
+    fn load_next_benchmark_page(&mut self) {
+        let benchmark = match &mut self.benchmark {
+            Some(benchmark) => benchmark,
+            None => return,
+        };
+
+        let window = match self.windows.values_mut().next() {
+            Some(window) => window,
+            None => return,
+        };
+
+        // Load every page repeatedly in both lazy loading modes, then open them
+        // in new tabs.
+        let tab_count = benchmark.tab_results.len();
+        let run = benchmark.results.len() / ITERATIONS;
+        let (page, multi_tab) = match benchmark.lazy_loading_modes.get(run / PAGES.len()) {
+            Some(&lazy_loading) => {
+                // Lazy loading scripts are replaced for the next navigation.
+                if self.config.lazy_loading.enabled != lazy_loading {
+                    self.config.lazy_loading.enabled = lazy_loading;
+                    window.set_config(self.config.clone());
+                }
+                (PAGES[run % PAGES.len()], false)
+            },
+            None if tab_count < MULTI_TAB_COUNT => (PAGES[tab_count % PAGES.len()], true),
+            None => {
+                benchmark.report();
+                benchmark.cleanup();
+                self.main_loop.quit();
+                return;
+            },
+        };
+
+        if multi_tab {
+            if let Err(err) = window.add_tab(false) {
+                error!("Could not open benchmark tab: {err}");
+                benchmark.tab_results.resize_with(MULTI_TAB_COUNT, || LoadResult::failed(page));
+                self.load_next_benchmark_page();
+                return;
+            }
+        }
+
+        // Give up on pages which never finish loading.
+        let mut queue = self.queue.clone();
+        let timeout = source::timeout_add_local_once(LOAD_TIMEOUT, move || {
+            queue.finish_benchmark_page();
+        });
+
+        let uri = format!("{}{page}", benchmark.base_uri);
+        benchmark.pending = Some(PendingLoad {
+            page,
+            multi_tab,
+            lazy_loading: self.config.lazy_loading.enabled,
+            engine_id: window.active_tab(),
+            uri: uri.clone(),
+            timeout: Some(timeout),
+            start: Instant::now(),
+            load_time: None,
+            frames: 0,
+        });
+
+        window.load_uri(uri);
+    }
+
+    fn finish_benchmark_page(&mut self) {
+        let benchmark = match &mut self.benchmark {
+            Some(benchmark) => benchmark,
+            None => return,
+        };
+        let pending = match benchmark.pending.take() {
+            Some(pending) => pending,
+            None => return,
+        };
+
+        let result = LoadResult {
+            page: pending.page,
+            lazy_loading: pending.lazy_loading,
+            load_time: pending.load_time,
+            frames: pending.frames,
+            memory_kb: browser_memory_kb(),
+            web_processes: crate::process::web_processes().len(),
+        };
+        match result.load_time {
+            Some(load_time) => info!(
+                "Loaded {} in {}ms ({} frames)",
+                result.page,
+                load_time.as_millis(),
+                result.frames
+            ),
+            None => warn!("Timed out loading {}", result.page),
+        }
+        match pending.multi_tab {
+            true => benchmark.tab_results.push(result),
+            false => benchmark.results.push(result),
+        }
+
+        self.load_next_benchmark_page();
+    }
+}
+
+impl State {
+    /// Start benchmarking in the first window.
+    ///
+    /// The `profile_dir` is removed once the benchmark is complete.
+    pub fn start_benchmark(&mut self, profile_dir: PathBuf) -> io::Result<()> {
+        let base_uri = spawn_fixture_server()?;
+        info!("Serving benchmark corpus at {base_uri}");
+
+        // Finish with the configured mode, which is also used for the tabs.
+        let lazy_loading = self.config.lazy_loading.enabled;
+
+        self.benchmark = Some(Benchmark {
+            lazy_loading_modes: [!lazy_loading, lazy_loading],
+            base_uri,
+            profile_dir,
+            tab_results: Default::default(),
+            results: Default::default(),
+            pending: Default::default(),
+        });
+        self.load_next_benchmark_page();
+
+        Ok(())
+    }
+
+    /// Handle completion of a page load.
+    pub fn benchmark_load_finished(&mut self, engine_id: EngineId) {
+        let pending = match self.benchmark.as_mut().and_then(|b| b.pending.as_mut()) {
+            Some(pending) if pending.engine_id == engine_id && pending.load_time.is_none() => {
+                pending
+            },
+            _ => return,
+        };
+
+        // Ignore completion of the previous page.
+        let window = self.windows.get(&engine_id.window_id());
+        let engine = window.and_then(|window| window.tabs().get(&engine_id));
+        if engine.map_or(true, |engine| engine.uri() != pending.uri) {
+            return;
+        }
+
+        pending.load_time = Some(pending.start.elapsed());
+        if let Some(timeout) = pending.timeout.take() {
+            timeout.remove();
+        }
+
+        // Keep counting frames until rendering has settled.
+        let mut queue = self.queue.clone();
+        source::timeout_add_local_once(SETTLE_DELAY, move || queue.finish_benchmark_page());
+    }
+
+    /// Count a frame rendered by an engine.
+    pub fn benchmark_frame(&mut self, engine_id: EngineId) {
+        if let Some(pending) = self.benchmark.as_mut().and_then(|b| b.pending.as_mut()) {
+            if pending.engine_id == engine_id {
+                pending.frames += 1;
+            }
+        }
+    }
+}
+
+/// Benchmark run state.
+pub struct Benchmark {
+    lazy_loading_modes: [bool; 2],
+    base_uri: String,
+    profile_dir: PathBuf,
+    results: Vec<LoadResult>,
+    tab_results: Vec<LoadResult>,
+    pending: Option<PendingLoad>,
+}
+
+impl Benchmark {
+    /// Print the results of all pages.
+    fn report(&self) {
+        println!("page\tlazy\tloads\tfailed\tmin_ms\tmedian_ms\tmax_ms\tframes\tpss_mib");
+
+        let runs = PAGES.iter().flat_map(|page| [false, true].map(|lazy| (page, lazy)));
+        for (page, lazy_loading) in runs {
+            let results = self
+                .results
+                .iter()
+                .filter(|result| result.page == *page && result.lazy_loading == lazy_loading);
+
+            let mut load_times: Vec<_> =
+                results.clone().filter_map(|result| result.load_time).collect();
+            load_times.sort_unstable();
+            let failed = ITERATIONS - load_times.len();
+
+            let mut frames: Vec<_> = results.clone().map(|result| result.frames).collect();
+            frames.sort_unstable();
+
+            let memory_kb = results.filter_map(|result| result.memory_kb).max();
+
+            let millis = |load_time: Option<&Duration>| {
+                load_time.map_or("-".into(), |load_time| load_time.as_millis().to_string())
+            };
+            let lazy = if lazy_loading { "on" } else { "off" };
+            println!(
+                "{page}\t{lazy}\t{ITERATIONS}\t{failed}\t{}\t{}\t{}\t{}\t{}",
+                millis(load_times.first()),
+                millis(load_times.get(load_times.len() / 2)),
+                millis(load_times.last()),
+                frames.get(frames.len() / 2).copied().unwrap_or_default(),
+                memory_kb.map_or("-".into(), |memory_kb| (memory_kb / 1024).to_string()),
+            );
+        }
+
+        // Memory and processes grow with every tab opened by the multi-tab scenario.
+        println!();
+        println!("tabs\tpage\tload_ms\tweb_processes\tpss_mib");
+        for (i, result) in self.tab_results.iter().enumerate() {
+            let load_time = result.load_time.map(|load_time| load_time.as_millis());
+            let memory_mib = result.memory_kb.map(|memory_kb| memory_kb / 1024);
+            println!(
+                "{}\t{}\t{}\t{}\t{}",
+                i + 2,
+                result.page,
+                load_time.map_or("-".into(), |load_time| load_time.to_string()),
+                result.web_processes,
+                memory_mib.map_or("-".into(), |memory_mib| memory_mib.to_string()),
+            );
+        }
+    }
+
+    /// Remove the isolated browser profile.
+    fn cleanup(&self) {
+        if let Err(err) = fs::remove_dir_all(&self.profile_dir) {
+            error!("Could not remove benchmark profile {:?}: {err}", self.profile_dir);
+        }
+    }
+}
+
+/// Page load waiting for completion.
+struct PendingLoad {
+    page: &'static str,
+    multi_tab: bool,
+    lazy_loading: bool,
+    engine_id: EngineId,
+    uri: String,
+    timeout: Option<SourceId>,
+    start: Instant,
+    load_time: Option<Duration>,
+    frames: usize,
+}
+
+/// Measurements of a single page load.
+struct LoadResult {
+    page: &'static str,
+    lazy_loading: bool,
+    load_time: Option<Duration>,
+    frames: usize,
+    memory_kb: Option<u64>,
+    web_processes: usize,
+}
+
+impl LoadResult {
+    /// Result of a page which could not be loaded.
+    fn failed(page: &'static str) -> Self {
+        Self {
+            page,
+            lazy_loading: false,
+            load_time: None,
+            frames: 0,
+            memory_kb: None,
+            web_processes: 0,
+        }
+    }
+}
+
+/// Redirect all browser data to a temporary directory.
+///
+/// This keeps benchmark runs reproducible, without touching the user's
+/// history, session, or caches. The config file is still loaded as usual, so
+/// different settings can be compared.
+pub fn isolate_profile() -> io::Result<PathBuf> {
+    let profile_dir = env::temp_dir().join(format!("kumo-benchmark-{}", process::id()));
+    fs::create_dir_all(&profile_dir)?;
+
+    env::set_var("XDG_DATA_HOME", profile_dir.join("data"));
+    env::set_var("XDG_CACHE_HOME", profile_dir.join("cache"));
+
+    Ok(profile_dir)
+}
+
+/// Get the combined memory usage of the browser and all its child processes.
+fn browser_memory_kb() -> Option<u64> {
+    let browser_kb = memory::process_pss_kb(process::id())?;
+    let children = crate::process::child_processes().into_iter();
+    let children_kb: u64 = children.filter_map(memory::process_pss_kb).sum();
+    Some(browser_kb + children_kb)
+}
+
+/// Serve the benchmark corpus on a random local port.
+///
+/// Returns the server's base URI.
+fn spawn_fixture_server() -> io::Result<String> {
+    let listener = TcpListener::bind((Ipv4Addr::LOCALHOST, 0))?;
+    let base_uri = format!("http://{}", listener.local_addr()?);
+
+    thread::spawn(move || {
+        for stream in listener.incoming().flatten() {
+            thread::spawn(move || {
+                if let Err(err) = serve_fixture(stream) {
+                    warn!("Could not serve benchmark fixture: {err}");
+                }
+            });
+        }
+    });
+
+    Ok(base_uri)
+}
+
+/// Respond to a single HTTP request.
+fn serve_fixture(mut stream: TcpStream) -> io::Result<()> {
+    let mut reader = BufReader::new(&stream);
+    let mut request_line = String::new();
+    reader.read_line(&mut request_line)?;
+
+    // Skip all request headers.
+    let mut header = String::new();
+    while reader.read_line(&mut header)? > 2 {
+        header.clear();
+    }
+
+    let fixture = request_path(&request_line)
+        .and_then(|path| FIXTURES.iter().find(|(fixture_path, ..)| *fixture_path == path));
+
+    // Disable caching, so repeated loads are comparable.
+    let (status, content_type, body) = match fixture {
+        Some((_, content_type, body)) => ("200 OK", *content_type, *body),
+        None => ("404 Not Found", "text/plain", &b"Not Found"[..]),
+    };
+    write!(
+        stream,
+        "HTTP/1.1 {status}\r\nContent-Type: {content_type}\r\nContent-Length: \
+         {}\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n",
+        body.len(),
+    )?;
+    stream.write_all(body)?;
+    stream.flush()
+}
+
+/// Extract the path without query from an HTTP request line.
+fn request_path(request_line: &str) -> Option<&str> {
+    let target = request_line.split_whitespace().nth(1)?;
+    let path = target.split(['?', '#']).next()?;
+    Some(path)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn request_line_path() {
+        assert_eq!(request_path("GET /article.html HTTP/1.1\r\n"), Some("/article.html"));
+        assert_eq!(request_path("GET /image.svg?12 HTTP/1.1\r\n"), Some("/image.svg"));
+        assert_eq!(request_path("GET / HTTP/1.1\r\n"), Some("/"));
+        assert_eq!(request_path("\r\n"), None);
+    }
+
+    #[test]
+    fn fixtures_complete() {
+        for page in PAGES {
+            assert!(FIXTURES.iter().any(|(path, ..)| path == page));
+        }
+    }
+}
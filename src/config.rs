@@ -0,0 +1,304 @@
+//! Configuration file.
+
+use std::path::PathBuf;
+
+use funq::StQueueHandle;
+use gio::prelude::{FileExt, FileMonitorExt, NetworkMonitorExt};
+use gio::{Cancellable, File, FileMonitor, FileMonitorEvent, FileMonitorFlags, NetworkMonitor};
+use glib::{KeyFile, KeyFileFlags};
+use tracing::{error, info, warn};
+
+use crate::engine::EngineProfile;
+use crate::State;
+
+#[funq::callbacks(State)]
+pub trait ConfigHandler {
+    /// Reload the configuration file.
+    fn reload_config(&mut self);
+
+    /// Update the data-saver after network changes.
+    fn update_data_saver(&mut self);
+}
+
+impl ConfigHandler for State {
+    fn reload_config(&mut self) {
+        self.config = Config::load();
+
+        for window in self.windows.values_mut() {
+            window.set_config(self.config.clone());
+        }
+    }
+
+    fn update_data_saver(&mut self) {
+        let enabled = self.config.data_saver.enabled();
+        for window in self.windows.values_mut() {
+            window.set_data_saver(enabled);
+        }
+    }
+}
+
+/// Browser configuration.
+#[derive(Clone, Default, Debug)]
+pub struct Config {
+    pub prerender: PrerenderConfig,
+    pub engine: EngineConfig,
+    pub storage: StorageConfig,
+    pub data_saver: DataSaverConfig,
+    pub lazy_loading: LazyLoadingConfig,
+    pub page_cache: PageCacheConfig,
+    pub metrics: MetricsConfig,
+}
+
+impl Config {
+    /// Load configuration from the default config file location.
+    pub fn load() -> Self {
+        let mut config = Self::default();
+
+        // Fall back to defaults without a config file.
+        let path = match config_path() {
+            Some(path) if path.exists() => path,
+            _ => return config,
+        };
+
+        let key_file = KeyFile::new();
+        if let Err(err) = key_file.load_from_file(&path, KeyFileFlags::NONE) {
+            error!("Could not load config {path:?}: {err}");
+            return config;
+        }
+
+        // Prerender settings.
+        if let Ok(enabled) = key_file.boolean("prerender", "enabled") {
+            config.prerender.enabled = enabled;
+        }
+        if let Ok(min_views) = key_file.integer("prerender", "min_views") {
+            config.prerender.min_views = min_views.max(0) as u32;
+        }
+        if let Ok(min_memory_mb) = key_file.uint64("prerender", "min_memory_mb") {
+            config.prerender.min_memory_mb = min_memory_mb;
+        }
+
+        // Engine settings.
+        match key_file.string("engine", "profile").as_deref() {
+            Ok("default") => config.engine.profile = EngineProfile::Default,
+            Ok("low-power") => config.engine.profile = EngineProfile::LowPower,
+            Ok(profile) => warn!("Ignoring unknown engine profile {profile:?}"),
+            Err(_) => (),
+        }
+        if let Ok(max_processes) = key_file.integer("engine", "max_processes") {
+            config.engine.max_processes = max_processes.max(0) as u32;
+        }
+
+        // Storage settings.
+        if let Ok(disk_cache_mb) = key_file.uint64("storage", "disk_cache_mb") {
+            config.storage.disk_cache_mb = disk_cache_mb;
+        }
+        if let Ok(sites) = key_file.integer("storage", "local_storage_sites") {
+            config.storage.local_storage_sites = sites.max(0) as u32;
+        }
+        if let Ok(sites) = key_file.integer("storage", "indexeddb_sites") {
+            config.storage.indexeddb_sites = sites.max(0) as u32;
+        }
+        if let Ok(sites) = key_file.integer("storage", "service_worker_sites") {
+            config.storage.service_worker_sites = sites.max(0) as u32;
+        }
+
+        // Data-saver settings.
+        match key_file.string("data_saver", "mode").as_deref() {
+            Ok("off") => config.data_saver.mode = DataSaverMode::Off,
+            Ok("on") => config.data_saver.mode = DataSaverMode::On,
+            Ok("metered") => config.data_saver.mode = DataSaverMode::Metered,
+            Ok(mode) => warn!("Ignoring unknown data-saver mode {mode:?}"),
+            Err(_) => (),
+        }
+
+        // Lazy loading settings.
+        if let Ok(enabled) = key_file.boolean("lazy_loading", "enabled") {
+            config.lazy_loading.enabled = enabled;
+        }
+        if let Ok(sites) = key_file.string_list("lazy_loading", "excluded_sites") {
+            config.lazy_loading.excluded_sites =
+                sites.iter().map(|site| site.to_string()).collect();
+        }
+
+        // Page cache settings.
+        if let Ok(enabled) = key_file.boolean("page_cache", "enabled") {
+            config.page_cache.enabled = enabled;
+        }
+        if let Ok(min_memory_mb) = key_file.uint64("page_cache", "min_memory_mb") {
+            config.page_cache.min_memory_mb = min_memory_mb;
+        }
+
+        // Metrics settings.
+        if let Ok(enabled) = key_file.boolean("metrics", "enabled") {
+            config.metrics.enabled = enabled;
+        }
+        if let Ok(store) = key_file.boolean("metrics", "store") {
+            config.metrics.store = store;
+        }
+
+        info!("Loaded config from {path:?}");
+
+        config
+    }
+
+    /// Reload the configuration whenever the config file changes.
+    ///
+    /// The returned monitor must be kept alive for as long as the config
+    /// should be reloaded.
+    pub fn watch(queue: StQueueHandle<State>) -> Option<FileMonitor> {
+        let file = File::for_path(config_path()?);
+        let monitor = match file.monitor_file(FileMonitorFlags::NONE, None::<&Cancellable>) {
+            Ok(monitor) => monitor,
+            Err(err) => {
+                error!("Could not watch config file: {err}");
+                return None;
+            },
+        };
+
+        monitor.connect_changed(move |_, _, _, event| {
+            if matches!(
+                event,
+                FileMonitorEvent::ChangesDoneHint
+                    | FileMonitorEvent::Created
+                    | FileMonitorEvent::Deleted
+            ) {
+                queue.clone().reload_config();
+            }
+        });
+
+        Some(monitor)
+    }
+}
+
+/// Background prerendering of the top URI bar suggestion.
+#[derive(Copy, Clone, Debug)]
+pub struct PrerenderConfig {
+    /// Whether prerendering is enabled.
+    pub enabled: bool,
+    /// Minimum history views required for a suggestion to be prerendered.
+    pub min_views: u32,
+    /// Minimum available system memory in MiB required to prerender.
+    pub min_memory_mb: u64,
+}
+
+impl Default for PrerenderConfig {
+    fn default() -> Self {
+        Self { enabled: false, min_views: 5, min_memory_mb: 512 }
+    }
+}
+
+/// Browser engine settings.
+#[derive(Copy, Clone, Default, Debug)]
+pub struct EngineConfig {
+    /// Engine feature profile.
+    pub profile: EngineProfile,
+    /// Maximum number of web processes per window, `0` for no limit.
+    pub max_processes: u32,
+}
+
+/// Website data storage budgets.
+///
+/// Budgets are enforced periodically, removing data of the least recently
+/// visited sites first. A budget of `0` is unlimited.
+#[derive(Copy, Clone, Debug)]
+pub struct StorageConfig {
+    /// Maximum HTTP disk cache size in MiB.
+    pub disk_cache_mb: u64,
+    /// Maximum number of sites with local storage.
+    pub local_storage_sites: u32,
+    /// Maximum number of sites with IndexedDB databases.
+    pub indexeddb_sites: u32,
+    /// Maximum number of sites with service worker registrations.
+    pub service_worker_sites: u32,
+}
+
+impl Default for StorageConfig {
+    fn default() -> Self {
+        Self {
+            disk_cache_mb: 256,
+            local_storage_sites: 200,
+            indexeddb_sites: 50,
+            service_worker_sites: 25,
+        }
+    }
+}
+
+/// Bandwidth reduction settings.
+#[derive(Copy, Clone, Default, Debug)]
+pub struct DataSaverConfig {
+    pub mode: DataSaverMode,
+}
+
+impl DataSaverConfig {
+    /// Check whether the data-saver should currently be active.
+    pub fn enabled(&self) -> bool {
+        match self.mode {
+            DataSaverMode::Off => false,
+            DataSaverMode::On => true,
+            DataSaverMode::Metered => NetworkMonitor::default().is_network_metered(),
+        }
+    }
+
+    /// Update the data-saver whenever the network's metered state changes.
+    pub fn watch_metered(queue: StQueueHandle<State>) {
+        NetworkMonitor::default().connect_network_metered_notify(move |_| {
+            queue.clone().update_data_saver();
+        });
+    }
+}
+
+/// Data-saver activation.
+#[derive(Copy, Clone, PartialEq, Eq, Default, Debug)]
+pub enum DataSaverMode {
+    /// Data-saver is always disabled.
+    #[default]
+    Off,
+    /// Data-saver is always enabled.
+    On,
+    /// Data-saver is enabled on metered network connections.
+    Metered,
+}
+
+/// Forced lazy loading of images and iframes.
+#[derive(Clone, PartialEq, Eq, Debug)]
+pub struct LazyLoadingConfig {
+    /// Whether lazy loading is forced.
+    pub enabled: bool,
+    /// Domains which are loaded without any changes, including subdomains.
+    pub excluded_sites: Vec<String>,
+}
+
+impl Default for LazyLoadingConfig {
+    fn default() -> Self {
+        Self { enabled: true, excluded_sites: Default::default() }
+    }
+}
+
+/// Back/forward page cache.
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+pub struct PageCacheConfig {
+    /// Whether pages are kept in memory for instant back/forward navigation.
+    pub enabled: bool,
+    /// Minimum available system memory in MiB required to cache pages.
+    pub min_memory_mb: u64,
+}
+
+impl Default for PageCacheConfig {
+    fn default() -> Self {
+        Self { enabled: true, min_memory_mb: 256 }
+    }
+}
+
+/// Page load performance metrics.
+#[derive(Copy, Clone, Default, Debug)]
+pub struct MetricsConfig {
+    /// Whether load metrics are collected and logged for every page.
+    pub enabled: bool,
+    /// Whether collected metrics are stored in the history database.
+    pub store: bool,
+}
+
+/// Get the config file path.
+fn config_path() -> Option<PathBuf> {
+    Some(dirs::config_dir()?.join("kumo/kumo.ini"))
+}
@@ -1,20 +1,71 @@
 use std::any::Any;
-use std::collections::HashMap;
+use std::ffi::c_void;
+use std::fmt::{self, Display, Formatter};
 use std::sync::atomic::{AtomicUsize, Ordering};
 
 use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
 use smithay_client_toolkit::seat::keyboard::{Keysym, Modifiers};
 use smithay_client_toolkit::seat::pointer::AxisScroll;
 
+use crate::config::{LazyLoadingConfig, PageCacheConfig};
+use crate::input::TouchPoints;
 use crate::ui::overlay::option_menu::OptionMenuId;
 use crate::window::TextInputChange;
 use crate::{Position, Size, WindowId};
 
+pub mod placeholder;
 pub mod webkit;
 
 /// Default engine background color.
 pub const BG: [f64; 3] = [0.1, 0.1, 0.1];
 
+/// Engine feature profiles.
+#[derive(Copy, Clone, PartialEq, Eq, Default, Debug)]
+pub enum EngineProfile {
+    /// All features enabled.
+    #[default]
+    Default,
+    /// Expensive features disabled, to reduce CPU and memory usage.
+    LowPower,
+}
+
+/// Load performance of a single navigation.
+///
+/// All timings are in milliseconds since the start of the navigation.
+#[derive(Clone, Default, Debug)]
+pub struct PageMetrics {
+    pub uri: String,
+    /// Name and version of the engine which loaded the page.
+    pub engine_version: String,
+    pub time_to_first_byte: Option<f64>,
+    pub dom_content_loaded: Option<f64>,
+    pub load: Option<f64>,
+    pub first_contentful_paint: Option<f64>,
+    pub largest_contentful_paint: Option<f64>,
+}
+
+impl Display for PageMetrics {
+    fn fmt(&self, f: &mut Formatter<'_>) -> fmt::Result {
+        let timings = [
+            ("ttfb", self.time_to_first_byte),
+            ("dcl", self.dom_content_loaded),
+            ("load", self.load),
+            ("fcp", self.first_contentful_paint),
+            ("lcp", self.largest_contentful_paint),
+        ];
+
+        for (i, (name, timing)) in timings.into_iter().enumerate() {
+            let separator = if i == 0 { "" } else { " " };
+            match timing {
+                Some(timing) => write!(f, "{separator}{name}={timing:.0}ms")?,
+                None => write!(f, "{separator}{name}=-")?,
+            }
+        }
+
+        Ok(())
+    }
+}
+
 pub trait Engine {
     /// Get the engine's unique ID.
     fn id(&self) -> EngineId;
@@ -34,9 +85,52 @@ pub trait Engine {
     /// Get the Wayland buffer's current physical size.
     fn buffer_size(&self) -> Size;
 
+    /// Get the EGLImage of the engine's latest frame and its physical size.
+    ///
+    /// The image is owned by the engine and only valid until the engine's
+    /// events are dispatched again.
+    fn egl_image(&self) -> Option<(*mut c_void, Size)>;
+
     /// Update the browser engine's scale.
     fn set_scale(&mut self, scale: f64);
 
+    /// Update the engine's visibility.
+    ///
+    /// Hidden engines keep loading content, but do not render it to the
+    /// screen.
+    fn set_visible(&mut self, visible: bool);
+
+    /// Update the engine's feature profile.
+    fn set_profile(&mut self, profile: EngineProfile);
+
+    /// Toggle blocking of bandwidth-heavy resources.
+    fn set_data_saver(&mut self, enabled: bool);
+
+    /// Update forced lazy loading of images and iframes.
+    fn set_lazy_loading(&mut self, config: &LazyLoadingConfig);
+
+    /// Update the back/forward page cache settings.
+    fn set_page_cache(&mut self, config: PageCacheConfig);
+
+    /// Toggle page load metrics collection.
+    fn set_metrics(&mut self, enabled: bool);
+
+    /// Get the ID of the engine which spawned this engine's web process.
+    ///
+    /// Engines sharing a web process report the same ID. Engines without a web
+    /// process return `None`.
+    fn process_owner(&self) -> Option<EngineId>;
+
+    /// Check whether pinch gestures can be previewed by scaling the last
+    /// buffer.
+    ///
+    /// This is `false` for pages which are not zoomable or handle pinch
+    /// gestures themselves.
+    fn pinch_previewable(&self) -> bool;
+
+    /// Get the page's current pinch zoom scale.
+    fn page_scale(&self) -> f64;
+
     /// Handle key down.
     fn press_key(&mut self, raw: u32, keysym: Keysym, modifiers: Modifiers);
 
@@ -67,27 +161,15 @@ pub trait Engine {
     fn pointer_motion(&mut self, time: u32, position: Position<f64>, modifiers: Modifiers);
 
     /// Handle touch press.
-    fn touch_up(
-        &mut self,
-        touch_points: &HashMap<i32, Position<f64>>,
-        time: u32,
-        id: i32,
-        modifiers: Modifiers,
-    );
+    fn touch_up(&mut self, touch_points: &TouchPoints, time: u32, id: i32, modifiers: Modifiers);
 
     /// Handle touch release.
-    fn touch_down(
-        &mut self,
-        touch_points: &HashMap<i32, Position<f64>>,
-        time: u32,
-        id: i32,
-        modifiers: Modifiers,
-    );
+    fn touch_down(&mut self, touch_points: &TouchPoints, time: u32, id: i32, modifiers: Modifiers);
 
     /// Handle touch motion.
     fn touch_motion(
         &mut self,
-        touch_points: &HashMap<i32, Position<f64>>,
+        touch_points: &TouchPoints,
         time: u32,
         id: i32,
         modifiers: Modifiers,
@@ -105,6 +187,16 @@ pub trait Engine {
     /// Get tab title.
     fn title(&self) -> String;
 
+    /// Get the serialized back-forward history.
+    ///
+    /// Returns an empty buffer if the history could not be serialized.
+    fn session_state(&self) -> Vec<u8>;
+
+    /// Restore serialized back-forward history and load its current page.
+    ///
+    /// Loads `uri` instead, if the history could not be restored.
+    fn restore_session_state(&mut self, uri: &str, state: &[u8]);
+
     /// Get IME text_input state.
     fn text_input_state(&self) -> TextInputChange;
 
@@ -153,4 +245,11 @@ impl EngineId {
     pub fn window_id(&self) -> WindowId {
         self.window_id
     }
+
+    /// Get the ID's numeric value.
+    ///
+    /// Engine IDs are unique across all windows.
+    pub fn raw(&self) -> u64 {
+        self.id as u64
+    }
 }
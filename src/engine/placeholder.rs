@@ -0,0 +1,168 @@
+//! Placeholder for tabs which have not been loaded yet.
+
+use std::any::Any;
+use std::ffi::c_void;
+
+use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
+use smithay_client_toolkit::seat::keyboard::{Keysym, Modifiers};
+use smithay_client_toolkit::seat::pointer::AxisScroll;
+
+use crate::config::{LazyLoadingConfig, PageCacheConfig};
+use crate::engine::{Engine, EngineId, EngineProfile};
+use crate::input::TouchPoints;
+use crate::session::TabSession;
+use crate::ui::overlay::option_menu::OptionMenuId;
+use crate::window::TextInputChange;
+use crate::{Position, Size, WindowId};
+
+/// Engine without any web view.
+///
+/// Placeholders only hold a tab's URI, title, and history, so restored tabs
+/// can be listed without loading them. They are replaced by a real engine
+/// once their tab is activated.
+pub struct PlaceholderEngine {
+    id: EngineId,
+    tab: TabSession,
+}
+
+impl PlaceholderEngine {
+    pub fn new(window_id: WindowId, tab: TabSession) -> Self {
+        Self { id: EngineId::new(window_id), tab }
+    }
+}
+
+impl Engine for PlaceholderEngine {
+    fn id(&self) -> EngineId {
+        self.id
+    }
+
+    fn wl_buffer(&self) -> Option<&WlBuffer> {
+        None
+    }
+
+    fn dirty(&self) -> bool {
+        false
+    }
+
+    fn frame_done(&mut self) {}
+
+    fn set_size(&mut self, _size: Size) {}
+
+    fn buffer_size(&self) -> Size {
+        Size::default()
+    }
+
+    fn egl_image(&self) -> Option<(*mut c_void, Size)> {
+        None
+    }
+
+    fn set_scale(&mut self, _scale: f64) {}
+
+    fn set_visible(&mut self, _visible: bool) {}
+
+    fn set_profile(&mut self, _profile: EngineProfile) {}
+
+    fn set_data_saver(&mut self, _enabled: bool) {}
+
+    fn set_lazy_loading(&mut self, _config: &LazyLoadingConfig) {}
+
+    fn set_page_cache(&mut self, _config: PageCacheConfig) {}
+
+    fn set_metrics(&mut self, _enabled: bool) {}
+
+    fn process_owner(&self) -> Option<EngineId> {
+        None
+    }
+
+    fn pinch_previewable(&self) -> bool {
+        false
+    }
+
+    fn page_scale(&self) -> f64 {
+        1.
+    }
+
+    fn press_key(&mut self, _raw: u32, _keysym: Keysym, _modifiers: Modifiers) {}
+
+    fn release_key(&mut self, _raw: u32, _keysym: Keysym, _modifiers: Modifiers) {}
+
+    fn pointer_axis(
+        &mut self,
+        _time: u32,
+        _position: Position<f64>,
+        _horizontal: AxisScroll,
+        _vertical: AxisScroll,
+        _modifiers: Modifiers,
+    ) {
+    }
+
+    fn pointer_button(
+        &mut self,
+        _time: u32,
+        _position: Position<f64>,
+        _button: u32,
+        _state: u32,
+        _modifiers: Modifiers,
+    ) {
+    }
+
+    fn pointer_motion(&mut self, _time: u32, _position: Position<f64>, _modifiers: Modifiers) {}
+
+    fn touch_up(&mut self, _points: &TouchPoints, _time: u32, _id: i32, _modifiers: Modifiers) {}
+
+    fn touch_down(&mut self, _points: &TouchPoints, _time: u32, _id: i32, _modifiers: Modifiers) {}
+
+    fn touch_motion(
+        &mut self,
+        _touch_points: &TouchPoints,
+        _time: u32,
+        _id: i32,
+        _modifiers: Modifiers,
+    ) {
+    }
+
+    fn load_uri(&self, _uri: &str) {}
+
+    fn load_prev(&self) {}
+
+    fn uri(&self) -> String {
+        self.tab.uri.clone()
+    }
+
+    fn title(&self) -> String {
+        self.tab.title.clone()
+    }
+
+    fn session_state(&self) -> Vec<u8> {
+        self.tab.state.clone()
+    }
+
+    fn restore_session_state(&mut self, uri: &str, state: &[u8]) {
+        self.tab.uri = uri.into();
+        self.tab.state = state.into();
+    }
+
+    fn text_input_state(&self) -> TextInputChange {
+        TextInputChange::Disabled
+    }
+
+    fn delete_surrounding_text(&mut self, _before_length: u32, _after_length: u32) {}
+
+    fn commit_string(&mut self, _text: String) {}
+
+    fn preedit_string(&mut self, _text: String, _cursor_begin: i32, _cursor_end: i32) {}
+
+    fn clear_focus(&mut self) {}
+
+    fn submit_option_menu(&mut self, _menu_id: OptionMenuId, _index: usize) {}
+
+    fn close_option_menu(&mut self, _menu_id: Option<OptionMenuId>) {}
+
+    fn confirm_enter_fullscreen(&mut self) {}
+
+    fn confirm_leave_fullscreen(&mut self) {}
+
+    fn as_any(&mut self) -> &mut dyn Any {
+        self
+    }
+}
@@ -0,0 +1,124 @@
+//! Dmabuf export of EGL images.
+
+use std::ffi::{c_void, CString};
+use std::mem;
+use std::os::fd::{AsRawFd, FromRawFd, OwnedFd};
+use std::sync::OnceLock;
+
+use glutin::display::{AsRawDisplay, Display, GetDisplayExtensions, RawDisplay};
+use wpe_backend_fdo_sys::EGLImageKHR;
+
+use crate::wayland::protocols::dmabuf::{DmabufBuffer, DmabufPlane};
+use crate::Size;
+
+/// EGL extension required for dmabuf export.
+const EXPORT_EXTENSION: &str = "EGL_MESA_image_dma_buf_export";
+
+/// Maximum number of planes in a dmabuf.
+const MAX_PLANES: usize = 4;
+
+/// Signature of `eglExportDMABUFImageQueryMESA`.
+type ExportQueryFn =
+    unsafe extern "system" fn(*const c_void, EGLImageKHR, *mut i32, *mut i32, *mut u64) -> u32;
+
+/// Signature of `eglExportDMABUFImageMESA`.
+type ExportFn =
+    unsafe extern "system" fn(*const c_void, EGLImageKHR, *mut i32, *mut i32, *mut i32) -> u32;
+
+/// Functions of the dmabuf export extension.
+struct DmabufExport {
+    query: ExportQueryFn,
+    export: ExportFn,
+}
+
+impl DmabufExport {
+    /// Load the extension functions.
+    ///
+    /// Returns `None` if the extension is not supported by the EGL display.
+    fn load(display: &Display) -> Option<Self> {
+        if !display.extensions().contains(EXPORT_EXTENSION) {
+            return None;
+        }
+
+        let Display::Egl(egl_display) = display;
+        let egl = egl_display.egl();
+        let proc_address = |name: &str| {
+            let name = CString::new(name).unwrap();
+            let address = unsafe { egl.GetProcAddress(name.as_ptr()) as *const c_void };
+            (!address.is_null()).then_some(address)
+        };
+
+        let query = proc_address("eglExportDMABUFImageQueryMESA")?;
+        let export = proc_address("eglExportDMABUFImageMESA")?;
+
+        unsafe { Some(Self { query: mem::transmute(query), export: mem::transmute(export) }) }
+    }
+}
+
+/// Export an EGLImage's underlying buffer as dmabuf.
+///
+/// Returns `None` if the image cannot be exported.
+pub fn export(display: &Display, image: EGLImageKHR, size: Size) -> Option<DmabufBuffer> {
+    static DMABUF_EXPORT: OnceLock<Option<DmabufExport>> = OnceLock::new();
+    let dmabuf_export = DMABUF_EXPORT.get_or_init(|| DmabufExport::load(display)).as_ref()?;
+
+    let RawDisplay::Egl(raw_display) = display.raw_display();
+
+    // Query buffer format and plane count.
+    let (mut format, mut num_planes) = (0, 0);
+    let mut modifiers = [0; MAX_PLANES];
+    let success = unsafe {
+        (dmabuf_export.query)(
+            raw_display,
+            image,
+            &mut format,
+            &mut num_planes,
+            modifiers.as_mut_ptr(),
+        )
+    };
+    let num_planes = num_planes as usize;
+    if success == 0 || num_planes == 0 || num_planes > MAX_PLANES {
+        return None;
+    }
+
+    // Export the plane file descriptors.
+    let mut fds = [-1; MAX_PLANES];
+    let mut strides = [0; MAX_PLANES];
+    let mut offsets = [0; MAX_PLANES];
+    let success = unsafe {
+        (dmabuf_export.export)(
+            raw_display,
+            image,
+            fds.as_mut_ptr(),
+            strides.as_mut_ptr(),
+            offsets.as_mut_ptr(),
+        )
+    };
+    if success == 0 || fds[0] < 0 {
+        return None;
+    }
+
+    let mut planes: Vec<DmabufPlane> = Vec::with_capacity(num_planes);
+    for i in 0..num_planes {
+        // Planes without a separate descriptor share the first plane's buffer.
+        let fd = if fds[i] >= 0 {
+            unsafe { OwnedFd::from_raw_fd(fds[i]) }
+        } else {
+            planes.first()?.fd.try_clone().ok()?
+        };
+        planes.push(DmabufPlane { fd, offset: offsets[i] as u32, stride: strides[i] as u32 });
+    }
+
+    Some(DmabufBuffer { size, format: format as u32, modifier: modifiers[0], planes })
+}
+
+/// Get a unique identifier for a dmabuf.
+///
+/// The kernel assigns every dmabuf a distinct inode number which is never
+/// reused, unlike the address of the EGLImage it was exported from.
+pub fn buffer_id(buffer: &DmabufBuffer) -> Option<u64> {
+    let fd = buffer.planes.first()?.fd.as_raw_fd();
+    let mut stat: libc::stat = unsafe { mem::zeroed() };
+    let result = unsafe { libc::fstat(fd, &mut stat) };
+    (result == 0).then_some(stat.st_ino as u64)
+}
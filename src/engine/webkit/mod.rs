@@ -1,9 +1,11 @@
 use std::any::Any;
+use std::cell::{Cell, RefCell};
 use std::collections::HashMap;
 use std::ffi::{self, CString};
-use std::ptr;
+use std::rc::Rc;
 use std::sync::Once;
 use std::time::UNIX_EPOCH;
+use std::{env, mem, ptr};
 
 use funq::StQueueHandle;
 use gio::Cancellable;
@@ -11,11 +13,12 @@ use glib::object::ObjectExt;
 use glib::Bytes;
 use glutin::api::egl::Egl;
 use glutin::display::{AsRawDisplay, Display, RawDisplay};
+use smithay_client_toolkit::globals::GlobalData;
 use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
 use smithay_client_toolkit::reexports::client::{Connection, Proxy};
 use smithay_client_toolkit::seat::keyboard::{Keysym, Modifiers};
 use smithay_client_toolkit::seat::pointer::AxisScroll;
-use tracing::{error, trace, warn};
+use tracing::{error, info, trace, warn};
 use wpe_backend_fdo_sys::{
     wpe_fdo_egl_exported_image, wpe_fdo_egl_exported_image_get_egl_image,
     wpe_fdo_egl_exported_image_get_height, wpe_fdo_egl_exported_image_get_width,
@@ -42,28 +45,99 @@ use wpe_backend_fdo_sys::{
     wpe_view_backend_exportable_fdo_egl_client, wpe_view_backend_exportable_fdo_egl_create,
     wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image,
     wpe_view_backend_exportable_fdo_get_view_backend, wpe_view_backend_remove_activity_state,
-    wpe_view_backend_set_fullscreen_handler,
+    wpe_view_backend_set_fullscreen_handler, EGLImageKHR,
 };
+use wpe_jsc::{Value as JscValue, ValueExt};
 use wpe_webkit::{
-    Color, CookieAcceptPolicy, CookiePersistentStorage, NetworkSession, OptionMenu,
-    UserContentFilterStore, WebView, WebViewBackend, WebViewExt,
+    CacheModel, Color, CookieAcceptPolicy, CookiePersistentStorage, LoadEvent, NetworkSession,
+    OptionMenu, UserContentFilter, UserContentFilterStore, UserContentInjectedFrames,
+    UserContentManager, UserScript, UserScriptInjectionTime, WebView, WebViewBackend, WebViewExt,
+    WebViewSessionState,
 };
 
+use crate::config::{LazyLoadingConfig, PageCacheConfig};
 use crate::engine::webkit::input_method_context::InputMethodContext;
-use crate::engine::{Engine, EngineId, BG};
+use crate::engine::{Engine, EngineId, EngineProfile, PageMetrics, BG};
+use crate::input::{TouchPoint, TouchPoints, MAX_TOUCH_POINTS};
+use crate::process::WebProcesses;
+use crate::site_policy::SitePolicies;
 use crate::ui::overlay::option_menu::{OptionMenuId, OptionMenuItem};
+use crate::wayland::protocols::dmabuf::{DmabufBuffer, DmabufFeedback};
 use crate::wayland::protocols::BufferData;
 use crate::window::TextInputChange;
-use crate::{Position, Size, State};
+use crate::{memory, Position, Size, State};
 
+mod dmabuf;
 mod input_method_context;
+pub mod storage;
+pub mod video_plane;
 
 /// Content filter store ID for the adblock json.
 const ADBLOCK_FILTER_ID: &str = "adblock";
 
+/// Content filter store ID for the data-saver json.
+const DATA_SAVER_FILTER_ID: &str = "data_saver";
+
+/// User script forcing lazy loading of images and iframes.
+const LAZY_LOAD_SCRIPT: &str = include_str!("../../../lazy_load.js");
+
+/// User script reporting page cache usage of back/forward navigations.
+const PAGE_CACHE_SCRIPT: &str = include_str!("../../../page_cache.js");
+
+/// Script world isolating browser scripts from the page.
+const SCRIPT_WORLD: &str = "kumo";
+
+/// Script message handler for navigations restored from the page cache.
+const PAGE_CACHE_RESTORED_HANDLER: &str = "pageCacheRestored";
+
+/// Script message handler for navigations reloaded despite the page cache.
+const PAGE_CACHE_RELOADED_HANDLER: &str = "pageCacheReloaded";
+
+/// User script reporting pinch zoom state.
+const PINCH_SCRIPT: &str = include_str!("../../../pinch.js");
+
+/// Script message handler for changes to pinch preview support.
+const PINCH_PREVIEW_HANDLER: &str = "pinchPreview";
+
+/// Script message handler for page scale changes.
+const PAGE_SCALE_HANDLER: &str = "pageScale";
+
+/// User script reporting page load performance metrics.
+const METRICS_SCRIPT: &str = include_str!("../../../metrics.js");
+
+/// Script message handler for page load performance metrics.
+const METRICS_HANDLER: &str = "pageMetrics";
+
+/// JavaScriptCore environment variable for toggling the JIT.
+const JSC_JIT_ENV: &str = "JSC_useJIT";
+
+/// Maximum number of Wayland buffers cached per engine.
+///
+/// WebKit usually only cycles through two or three buffers.
+const MAX_CACHED_BUFFERS: usize = 4;
+
 // Once for calling FDO initialization methods.
 static FDO_INIT: Once = Once::new();
 
+thread_local! {
+    /// Network session shared by all engines.
+    static NETWORK_SESSION: NetworkSession =
+        xdg_network_session().unwrap_or_else(NetworkSession::new_ephemeral);
+
+    /// Content filters by store ID, once they have been loaded.
+    static CONTENT_FILTERS: RefCell<HashMap<&'static str, UserContentFilter>> =
+        RefCell::default();
+
+    /// Scheduling priorities of all web processes.
+    static WEB_PROCESSES: RefCell<WebProcesses> = RefCell::default();
+
+    /// Per-site feature policies.
+    static SITE_POLICIES: SitePolicies = SitePolicies::load();
+
+    /// Page cache usage of all back/forward navigations.
+    static PAGE_CACHE_STATS: Cell<PageCacheStats> = Cell::default();
+}
+
 /// WebKit-specific errors.
 #[derive(thiserror::Error, Debug)]
 pub enum WebKitError {
@@ -99,6 +173,12 @@ trait WebKitHandler {
 
     /// Handle fullscreen enter/leave.
     fn set_fullscreen(&mut self, engine_id: EngineId, enable: bool);
+
+    /// Record load performance metrics of a page.
+    fn set_page_metrics(&mut self, engine_id: EngineId, metrics: PageMetrics);
+
+    /// Handle completion of a page load.
+    fn set_load_finished(&mut self, engine_id: EngineId);
 }
 
 impl WebKitHandler for State {
@@ -107,7 +187,7 @@ impl WebKitHandler for State {
             Some(window) => window,
             None => return,
         };
-        let engine = match window.tabs_mut().get_mut(&engine_id) {
+        let engine = match window.engine_mut(engine_id) {
             Some(engine) => engine,
             None => return,
         };
@@ -136,12 +216,14 @@ impl WebKitHandler for State {
         }
 
         // Update engine's WlBuffer.
-        webkit_engine.import_image(&self.connection, &self.egl_display, image);
+        webkit_engine.set_image(image);
 
         // Offer new WlBuffer to window.
         if window.active_tab() == engine_id {
             window.unstall();
         }
+
+        self.benchmark_frame(engine_id);
     }
 
     fn set_engine_uri(&mut self, engine_id: EngineId, uri: String) {
@@ -223,6 +305,18 @@ impl WebKitHandler for State {
             window.request_fullscreen(engine_id, enable);
         }
     }
+
+    fn set_page_metrics(&mut self, engine_id: EngineId, metrics: PageMetrics) {
+        info!("Page metrics of {engine_id:?} for {:?}: {metrics}", metrics.uri);
+
+        if self.config.metrics.store {
+            self.history.record_metrics(&metrics);
+        }
+    }
+
+    fn set_load_finished(&mut self, engine_id: EngineId) {
+        self.benchmark_load_finished(engine_id);
+    }
 }
 
 /// WebKit browser engine.
@@ -233,8 +327,14 @@ pub struct WebKitEngine {
 
     exportable: *mut wpe_view_backend_exportable_fdo,
     image: *mut wpe_fdo_egl_exported_image,
+    pending_image: *mut wpe_fdo_egl_exported_image,
+    buffer_cache: Vec<CachedBuffer>,
     buffer: Option<WlBuffer>,
 
+    dmabuf: Option<DmabufFeedback>,
+    connection: Connection,
+    egl_display: Display,
+
     target_size: Size,
     buffer_size: Size,
     scale: f32,
@@ -243,40 +343,75 @@ pub struct WebKitEngine {
     pointer_button: u32,
     pointer_state: u32,
 
+    // Reused touch event buffer.
+    touch_events: Vec<wpe_input_touch_event_raw>,
+
     egl: &'static Egl,
 
     id: EngineId,
+    process_owner: EngineId,
+    // Engine profile, shared with the site policy handler.
+    profile: Rc<Cell<EngineProfile>>,
+
+    // Data-saver state, shared with pending filter loads.
+    data_saver: Rc<Cell<bool>>,
+
+    lazy_load_script: Option<UserScript>,
+    metrics_script: Option<UserScript>,
+
+    // Page cache settings, shared with the navigation handler.
+    page_cache: Rc<Cell<PageCacheConfig>>,
+
+    // Pinch zoom state, shared with the pinch script's message handlers.
+    pinch_previewable: Rc<Cell<bool>>,
+    page_scale: Rc<Cell<f64>>,
 
     option_menu: Option<(OptionMenuId, OptionMenu)>,
 
+    visible: bool,
     dirty: bool,
 }
 
 impl Drop for WebKitEngine {
     fn drop(&mut self) {
+        WEB_PROCESSES
+            .with_borrow_mut(|processes| processes.unregister(self.process_owner, self.id));
+
         unsafe {
-            // Free EGL image.
-            if !self.image.is_null() {
-                wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(
-                    self.exportable,
-                    self.image,
-                );
+            // Free EGL images.
+            for image in [self.image, self.pending_image] {
+                if !image.is_null() {
+                    wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(
+                        self.exportable,
+                        image,
+                    );
+                }
             }
         }
+
+        // Free Wayland buffers.
+        self.clear_buffer_cache();
+        if let Some(buffer) = self.buffer.take() {
+            buffer.destroy();
+        }
     }
 }
 
 impl WebKitEngine {
     pub fn new(
         display: &Display,
+        connection: &Connection,
         queue: StQueueHandle<State>,
         engine_id: EngineId,
         size: Size,
         scale: f64,
+        profile: EngineProfile,
+        related: Option<&WebKitEngine>,
+        dmabuf: Option<DmabufFeedback>,
     ) -> Result<Self, WebKitError> {
         // Ensure FDO is initialized.
         let mut result = Ok(());
-        FDO_INIT.call_once(|| result = Self::init_fdo(display));
+        FDO_INIT.call_once(|| result = Self::init_fdo(display, queue.clone()));
         result?;
 
         // Create web view backend.
@@ -292,10 +427,76 @@ impl WebKitEngine {
             (WebViewBackend::new(egl_backend), exportable)
         };
 
-        // Create web view with initial blank page.
-        let network_session = xdg_network_session().unwrap_or_else(NetworkSession::new_ephemeral);
-        let web_view =
-            WebView::builder().network_session(&network_session).backend(&backend).build();
+        // Create web view, sharing the web process with the related engine.
+        let builder = WebView::builder().backend(&backend);
+        let (web_view, process_owner) = match related {
+            Some(related) => {
+                (builder.related_view(&related.web_view).build(), related.process_owner)
+            },
+            None => {
+                let network_session = NETWORK_SESSION.with(|session| session.clone());
+                (builder.network_session(&network_session).build(), engine_id)
+            },
+        };
+
+        // Apply engine feature profile before the web process is spawned.
+        apply_profile(&web_view, profile);
+        apply_site_policy(&web_view, profile, false);
+
+        let profile = Rc::new(Cell::new(profile));
+        let data_saver = Rc::new(Cell::new(false));
+        let (site_profile, site_data_saver) = (profile.clone(), data_saver.clone());
+        let page_cache = Rc::new(Cell::new(PageCacheConfig::default()));
+        let navigation_page_cache = page_cache.clone();
+        let pinch_previewable = Rc::new(Cell::new(true));
+        let page_scale = Rc::new(Cell::new(1.));
+        let (load_pinch_previewable, load_page_scale) =
+            (pinch_previewable.clone(), page_scale.clone());
+        let load_queue = queue.clone();
+        web_view.connect_load_changed(move |web_view, event| match event {
+            // Load events are only emitted for the main frame, so subframes
+            // cannot override the policy of the site they're embedded in.
+            LoadEvent::Started => {
+                apply_site_policy(web_view, site_profile.get(), site_data_saver.get());
+                apply_page_cache(web_view, navigation_page_cache.get());
+            },
+            LoadEvent::Redirected => {
+                apply_site_policy(web_view, site_profile.get(), site_data_saver.get());
+            },
+            // Reset pinch zoom state until the new page has reported it.
+            //
+            // The web process might have been replaced, so its priority is
+            // checked again.
+            LoadEvent::Committed => {
+                load_pinch_previewable.set(true);
+                load_page_scale.set(1.);
+                WEB_PROCESSES.with_borrow_mut(|processes| processes.update(process_owner));
+            },
+            LoadEvent::Finished => load_queue.clone().set_load_finished(engine_id),
+            _ => (),
+        });
+
+        // Track page cache usage and load performance.
+        if let Some(content_manager) = web_view.user_content_manager() {
+            track_page_cache(&content_manager);
+            track_pinch(&content_manager, pinch_previewable.clone(), page_scale.clone());
+            track_metrics(&content_manager, queue.clone(), engine_id);
+        }
+
+        // Start tracking the web process' priority before it is spawned.
+        WEB_PROCESSES.with_borrow_mut(|processes| processes.register(process_owner));
+
+        // Resolve the web process again once WebKit replaces it.
+        //
+        // The page ID changes when the page is swapped to a different process
+        // on navigation.
+        web_view.connect_page_id_notify(move |_| {
+            WEB_PROCESSES.with_borrow_mut(|processes| processes.replace(process_owner));
+        });
+        web_view.connect_web_process_terminated(move |_, _| {
+            WEB_PROCESSES.with_borrow_mut(|processes| processes.replace(process_owner));
+        });
+
         web_view.load_uri("about:blank");
 
         // Set browser background color.
@@ -352,16 +553,31 @@ impl WebKitEngine {
             exportable,
             web_view,
             backend,
-            target_size: size,
             egl,
+            dmabuf,
+            connection: connection.clone(),
+            egl_display: display.clone(),
+            target_size: size,
             image: ptr::null_mut(),
+            pending_image: ptr::null_mut(),
             id: engine_id,
+            process_owner,
+            profile,
+            page_cache,
+            pinch_previewable,
+            page_scale,
+            visible: true,
             scale: 1.0,
             pointer_button: Default::default(),
             pointer_state: Default::default(),
+            touch_events: Vec::with_capacity(MAX_TOUCH_POINTS),
             buffer_size: Default::default(),
             option_menu: Default::default(),
+            buffer_cache: Default::default(),
             buffer: Default::default(),
+            data_saver,
+            lazy_load_script: Default::default(),
+            metrics_script: Default::default(),
             dirty: Default::default(),
         };
 
@@ -371,13 +587,34 @@ impl WebKitEngine {
         Ok(engine)
     }
 
+    /// Update the engine's EGL image.
+    ///
+    /// Images for hidden engines are only imported once the engine is shown.
+    fn set_image(&mut self, image: *mut wpe_fdo_egl_exported_image) {
+        // Apply the web process' priority once its first frame proves it is running.
+        if self.image.is_null() && self.pending_image.is_null() {
+            WEB_PROCESSES.with_borrow_mut(|processes| processes.update(self.process_owner));
+        }
+
+        if self.visible {
+            self.import_image(image);
+            return;
+        }
+
+        // Replace previous pending image.
+        if !self.pending_image.is_null() {
+            unsafe {
+                wpe_view_backend_exportable_fdo_egl_dispatch_release_exported_image(
+                    self.exportable,
+                    self.pending_image,
+                );
+            }
+        }
+        self.pending_image = image;
+    }
+
     /// Import a new EGLImage as WlBuffer.
-    fn import_image(
-        &mut self,
-        connection: &Connection,
-        egl_display: &Display,
-        image: *mut wpe_fdo_egl_exported_image,
-    ) {
+    fn import_image(&mut self, image: *mut wpe_fdo_egl_exported_image) {
         // Require redraw.
         self.dirty = true;
 
@@ -391,23 +628,86 @@ impl WebKitEngine {
             }
         }
 
-        self.buffer_size = self.target_size * self.scale as f64;
+        let buffer_size = self.target_size * self.scale as f64;
+        let egl_image = unsafe { wpe_fdo_egl_exported_image_get_egl_image(image) };
+        self.buffer_size = buffer_size;
         self.image = image;
 
-        let RawDisplay::Egl(raw_display) = egl_display.raw_display();
+        // Drop buffers of outdated size, since WebKit reallocates on resize.
+        if self.buffer_cache.first().map_or(false, |cached| cached.size != buffer_size) {
+            self.clear_buffer_cache();
+        }
+
+        // Identify buffers by their dmabuf, since WPE can reuse the address of a
+        // destroyed EGLImage for an unrelated image.
+        let dmabuf = dmabuf::export(&self.egl_display, egl_image, buffer_size);
+        let buffer_id = dmabuf.as_ref().and_then(dmabuf::buffer_id);
+
+        // Reuse the existing WlBuffer for this dmabuf.
+        let cached_index = buffer_id
+            .and_then(|id| self.buffer_cache.iter().position(|cached| cached.buffer_id == id));
+        let buffer = match cached_index {
+            Some(index) => self.buffer_cache.remove(index).buffer,
+            None => self.create_buffer(egl_image, dmabuf),
+        };
+
+        // Destroy the previous buffer if it's not cached anymore.
+        if let Some(previous) = self.buffer.take() {
+            let is_cached = self.buffer_cache.iter().any(|cached| cached.buffer == previous);
+            if !is_cached && previous != buffer {
+                previous.destroy();
+            }
+        }
+
+        // Only cache buffers which can be identified again.
+        if let Some(buffer_id) = buffer_id {
+            // Evict the least recently used buffer.
+            if self.buffer_cache.len() >= MAX_CACHED_BUFFERS {
+                if let Some(cached) = self.buffer_cache.pop() {
+                    cached.buffer.destroy();
+                }
+            }
+
+            let cached = CachedBuffer { buffer: buffer.clone(), buffer_id, size: buffer_size };
+            self.buffer_cache.insert(0, cached);
+        }
+
+        self.buffer = Some(buffer);
+    }
+
+    /// Convert an EGLImage to a WlBuffer.
+    ///
+    /// Buffers are imported through linux-dmabuf when the compositor supports
+    /// the image's format, falling back to the legacy wl_drm path otherwise.
+    fn create_buffer(&self, egl_image: EGLImageKHR, dmabuf: Option<DmabufBuffer>) -> WlBuffer {
+        let dmabuf_buffer =
+            dmabuf.and_then(|buffer| self.dmabuf.as_ref()?.create_buffer(&buffer, GlobalData));
+        if let Some(buffer) = dmabuf_buffer {
+            return buffer;
+        }
+
+        let RawDisplay::Egl(raw_display) = self.egl_display.raw_display();
 
-        // Convert EGLImage to WlBuffer.
         let object_id = unsafe {
-            let egl_image = wpe_fdo_egl_exported_image_get_egl_image(self.image);
             let raw_wl_buffer = self.egl.CreateWaylandBufferFromImageWL(raw_display, egl_image);
-            let data = BufferData::new(connection.clone());
-            connection.backend().manage_object(WlBuffer::interface(), raw_wl_buffer.cast(), data)
+            let data = BufferData::new();
+            let backend = self.connection.backend();
+            backend.manage_object(WlBuffer::interface(), raw_wl_buffer.cast(), data)
         };
-        self.buffer = Some(WlBuffer::from_id(connection, object_id).unwrap());
+        WlBuffer::from_id(&self.connection, object_id).unwrap()
+    }
+
+    /// Destroy all cached buffers, except for the one currently in use.
+    fn clear_buffer_cache(&mut self) {
+        for cached in self.buffer_cache.drain(..) {
+            if self.buffer.as_ref() != Some(&cached.buffer) {
+                cached.buffer.destroy();
+            }
+        }
     }
 
     /// Initialize the WPEBackend-fdo library.
-    fn init_fdo(display: &Display) -> Result<(), WebKitError> {
+    fn init_fdo(display: &Display, queue: StQueueHandle<State>) -> Result<(), WebKitError> {
         unsafe {
             let RawDisplay::Egl(display) = display.raw_display();
 
@@ -420,6 +720,9 @@ impl WebKitEngine {
                 return Err(WebKitError::EglInit);
             }
 
+            // Receive hole-punched video frames.
+            video_plane::register_receiver(queue);
+
             Ok(())
         }
     }
@@ -427,19 +730,25 @@ impl WebKitEngine {
     /// Emit a touch input event.
     fn touch_event(
         &mut self,
-        touch_points: &[wpe_input_touch_event_raw],
+        touch_points: &TouchPoints,
         time: u32,
         id: i32,
         modifiers: Modifiers,
         type_: wpe_input_touch_event_type,
     ) {
+        // Convert touch points, reusing the previous event's buffer.
+        self.touch_events.clear();
+        self.touch_events.extend(
+            touch_points.iter().map(|point| wpe_touch_point(point, self.scale, time, id, type_)),
+        );
+
         let mut event = wpe_input_touch_event {
             type_,
             time,
             id,
-            touchpoints_length: touch_points.len() as u64,
+            touchpoints_length: self.touch_events.len() as u64,
             modifiers: wpe_modifiers(modifiers),
-            touchpoints: touch_points.as_ptr(),
+            touchpoints: self.touch_events.as_ptr(),
         };
 
         unsafe {
@@ -499,6 +808,21 @@ impl Engine for WebKitEngine {
         self.buffer_size
     }
 
+    fn egl_image(&self) -> Option<(EGLImageKHR, Size)> {
+        // Prefer images received while hidden, since they are more recent.
+        let image = if self.pending_image.is_null() { self.image } else { self.pending_image };
+        if image.is_null() {
+            return None;
+        }
+
+        unsafe {
+            let egl_image = wpe_fdo_egl_exported_image_get_egl_image(image);
+            let width = wpe_fdo_egl_exported_image_get_width(image);
+            let height = wpe_fdo_egl_exported_image_get_height(image);
+            Some((egl_image, Size::new(width, height)))
+        }
+    }
+
     fn set_scale(&mut self, scale: f64) {
         // Clamp scale to WebKit's limits.
         //
@@ -511,6 +835,129 @@ impl Engine for WebKitEngine {
         }
     }
 
+    fn set_visible(&mut self, visible: bool) {
+        self.visible = visible;
+
+        // Prioritize web processes of visible engines.
+        WEB_PROCESSES.with_borrow_mut(|processes| {
+            processes.set_visible(self.process_owner, self.id, visible);
+        });
+
+        // Import the latest image received while hidden.
+        if visible && !self.pending_image.is_null() {
+            let image = mem::replace(&mut self.pending_image, ptr::null_mut());
+            self.import_image(image);
+        }
+
+        let state = wpe_view_activity_state_wpe_view_activity_state_visible
+            | wpe_view_activity_state_wpe_view_activity_state_in_window;
+        unsafe {
+            let backend = self.backend.wpe_backend();
+            if visible {
+                wpe_view_backend_add_activity_state(backend, state);
+            } else {
+                wpe_view_backend_remove_activity_state(backend, state);
+            }
+        }
+    }
+
+    fn set_profile(&mut self, profile: EngineProfile) {
+        self.profile.set(profile);
+        apply_profile(&self.web_view, profile);
+        apply_site_policy(&self.web_view, profile, self.data_saver.get());
+    }
+
+    fn set_data_saver(&mut self, enabled: bool) {
+        if self.data_saver.get() == enabled {
+            return;
+        }
+        self.data_saver.set(enabled);
+
+        apply_site_policy(&self.web_view, self.profile.get(), enabled);
+
+        // Only toggle the data-saver filter, keeping all other filters in place.
+        if enabled {
+            load_data_saver(self.web_view.clone(), self.data_saver.clone());
+        } else if let Some(content_manager) = self.web_view.user_content_manager() {
+            content_manager.remove_filter_by_id(DATA_SAVER_FILTER_ID);
+        }
+    }
+
+    fn set_lazy_loading(&mut self, config: &LazyLoadingConfig) {
+        let content_manager = match self.web_view.user_content_manager() {
+            Some(content_manager) => content_manager,
+            None => return,
+        };
+
+        // Remove script with outdated settings.
+        if let Some(script) = self.lazy_load_script.take() {
+            content_manager.remove_script(&script);
+        }
+
+        if !config.enabled {
+            return;
+        }
+
+        // Skip excluded sites and all their subdomains.
+        let block_list: Vec<_> =
+            config.excluded_sites.iter().map(|site| format!("*://*.{site}/*")).collect();
+        let block_list: Vec<_> = block_list.iter().map(String::as_str).collect();
+
+        let script = UserScript::new(
+            LAZY_LOAD_SCRIPT,
+            UserContentInjectedFrames::AllFrames,
+            UserScriptInjectionTime::Start,
+            &[],
+            &block_list,
+        );
+        content_manager.add_script(&script);
+        self.lazy_load_script = Some(script);
+    }
+
+    fn set_page_cache(&mut self, config: PageCacheConfig) {
+        self.page_cache.set(config);
+        apply_page_cache(&self.web_view, config);
+    }
+
+    fn set_metrics(&mut self, enabled: bool) {
+        if self.metrics_script.is_some() == enabled {
+            return;
+        }
+
+        let content_manager = match self.web_view.user_content_manager() {
+            Some(content_manager) => content_manager,
+            None => return,
+        };
+
+        match self.metrics_script.take() {
+            Some(script) => content_manager.remove_script(&script),
+            None => {
+                let script = UserScript::for_world(
+                    METRICS_SCRIPT,
+                    UserContentInjectedFrames::TopFrame,
+                    UserScriptInjectionTime::Start,
+                    SCRIPT_WORLD,
+                    &[],
+                    &[],
+                );
+                content_manager.add_script(&script);
+                self.metrics_script = Some(script);
+            },
+        }
+    }
+
+    fn process_owner(&self) -> Option<EngineId> {
+        Some(self.process_owner)
+    }
+
+    fn pinch_previewable(&self) -> bool {
+        self.pinch_previewable.get()
+    }
+
+    fn page_scale(&self) -> f64 {
+        self.page_scale.get()
+    }
+
     fn press_key(&mut self, raw: u32, keysym: Keysym, modifiers: Modifiers) {
         let mut event = wpe_keyboard_event(raw, keysym, modifiers, true);
         unsafe {
@@ -606,42 +1053,27 @@ impl Engine for WebKitEngine {
         }
     }
 
-    fn touch_down(
-        &mut self,
-        touch_points: &HashMap<i32, Position<f64>>,
-        time: u32,
-        id: i32,
-        modifiers: Modifiers,
-    ) {
+    fn touch_down(&mut self, touch_points: &TouchPoints, time: u32, id: i32, modifiers: Modifiers) {
         self.set_focused(true);
 
         let event_type = wpe_input_touch_event_type_wpe_input_touch_event_type_down;
-        let touch_points = wpe_touch_points(touch_points, self.scale, time, id, event_type);
-        self.touch_event(&touch_points, time, id, modifiers, event_type);
+        self.touch_event(touch_points, time, id, modifiers, event_type);
     }
 
-    fn touch_up(
-        &mut self,
-        touch_points: &HashMap<i32, Position<f64>>,
-        time: u32,
-        id: i32,
-        modifiers: Modifiers,
-    ) {
+    fn touch_up(&mut self, touch_points: &TouchPoints, time: u32, id: i32, modifiers: Modifiers) {
         let event_type = wpe_input_touch_event_type_wpe_input_touch_event_type_up;
-        let touch_points = wpe_touch_points(touch_points, self.scale, time, id, event_type);
-        self.touch_event(&touch_points, time, id, modifiers, event_type);
+        self.touch_event(touch_points, time, id, modifiers, event_type);
     }
 
     fn touch_motion(
         &mut self,
-        touch_points: &HashMap<i32, Position<f64>>,
+        touch_points: &TouchPoints,
         time: u32,
         id: i32,
         modifiers: Modifiers,
     ) {
         let event_type = wpe_input_touch_event_type_wpe_input_touch_event_type_motion;
-        let touch_points = wpe_touch_points(touch_points, self.scale, time, id, event_type);
-        self.touch_event(&touch_points, time, id, modifiers, event_type);
+        self.touch_event(touch_points, time, id, modifiers, event_type);
     }
 
     fn load_uri(&self, uri: &str) {
@@ -660,6 +1092,26 @@ impl Engine for WebKitEngine {
         self.web_view.title().unwrap_or_default().into()
     }
 
+    fn session_state(&self) -> Vec<u8> {
+        let state = self.web_view.session_state().and_then(|state| state.serialize());
+        state.map(|state| state.to_vec()).unwrap_or_default()
+    }
+
+    fn restore_session_state(&mut self, uri: &str, state: &[u8]) {
+        if !state.is_empty() {
+            let state = WebViewSessionState::new(&Bytes::from(state));
+            self.web_view.restore_session_state(&state);
+        }
+
+        // Restoring the state does not load anything, so the current item is
+        // loaded explicitly.
+        let list = self.web_view.back_forward_list();
+        match list.and_then(|list| list.current_item()) {
+            Some(item) if !state.is_empty() => self.web_view.go_to_back_forward_list_item(&item),
+            _ => self.web_view.load_uri(uri),
+        }
+    }
+
     fn text_input_state(&self) -> TextInputChange {
         self.input_method_context.text_input_state()
     }
@@ -756,30 +1208,33 @@ fn wpe_modifiers(modifiers: Modifiers) -> u32 {
     wpe_modifiers
 }
 
-/// Convert touch points to WPE touch events.
-fn wpe_touch_points(
-    touch_points: &HashMap<i32, Position<f64>>,
+/// Convert a touch point to a WPE touch event.
+fn wpe_touch_point(
+    point: &TouchPoint,
     scale: f32,
     time: u32,
     main_id: i32,
     main_type: wpe_input_touch_event_type,
-) -> Vec<wpe_input_touch_event_raw> {
-    touch_points
-        .iter()
-        .map(|(&point_id, Position { x, y })| {
-            // Pretend all existing touch points just moved in place.
-            let type_ = if main_id == point_id {
-                main_type
-            } else {
-                wpe_input_touch_event_type_wpe_input_touch_event_type_motion
-            };
+) -> wpe_input_touch_event_raw {
+    // Pretend all other touch points just moved in place.
+    let type_ = if main_id == point.id {
+        main_type
+    } else {
+        wpe_input_touch_event_type_wpe_input_touch_event_type_motion
+    };
 
-            let x = (x * scale as f64).round() as i32;
-            let y = (y * scale as f64).round() as i32;
+    let x = (point.position.x * scale as f64).round() as i32;
+    let y = (point.position.y * scale as f64).round() as i32;
 
-            wpe_input_touch_event_raw { type_, time, id: point_id, x, y }
-        })
-        .collect()
+    wpe_input_touch_event_raw { type_, time, id: point.id, x, y }
+}
+
+/// Wayland buffer for an exported EGLImage.
+struct CachedBuffer {
+    /// Identity of the underlying dmabuf.
+    buffer_id: u64,
+    buffer: WlBuffer,
+    size: Size,
 }
 
 /// Shared state leaked to FDO backend callbacks.
@@ -856,42 +1311,286 @@ fn xdg_network_session() -> Option<NetworkSession> {
     Some(network_session)
 }
 
+/// Apply an engine feature profile to a web view.
+///
+/// The JavaScript JIT is configured once at startup, see [`configure_jit`].
+/// Features which can also be restricted per site are updated by
+/// [`apply_site_policy`].
+fn apply_profile(web_view: &WebView, profile: EngineProfile) {
+    let low_power = profile == EngineProfile::LowPower;
+
+    if let Some(settings) = web_view.settings() {
+        settings.set_enable_webaudio(!low_power);
+        settings.set_enable_smooth_scrolling(!low_power);
+        settings.set_enable_dns_prefetching(!low_power);
+    }
+
+    // Limit page and memory caches.
+    //
+    // The cache model is shared by all web views of the same context.
+    if let Some(web_context) = web_view.web_context() {
+        let cache_model =
+            if low_power { CacheModel::DocumentBrowser } else { CacheModel::WebBrowser };
+        if web_context.cache_model() != cache_model {
+            web_context.set_cache_model(cache_model);
+        }
+    }
+}
+
+/// Disable the JavaScript JIT for the low-power profile.
+///
+/// WebKit has no setting for this, so JSC's environment variable is used
+/// instead. Since it must be set before any threads or web processes are
+/// spawned, switching profiles only toggles the JIT after a restart.
+pub fn configure_jit(profile: EngineProfile) {
+    if profile == EngineProfile::LowPower {
+        env::set_var(JSC_JIT_ENV, "false");
+    }
+}
+
+/// Apply the feature policy of a web view's current site.
+///
+/// Site policies can only disable features permitted by the engine profile.
+/// The data-saver additionally disables media autoplay, to avoid unsolicited
+/// media downloads.
+fn apply_site_policy(web_view: &WebView, profile: EngineProfile, data_saver: bool) {
+    let settings = match web_view.settings() {
+        Some(settings) => settings,
+        None => return,
+    };
+
+    let uri = web_view.uri().unwrap_or_default();
+    let policy = SITE_POLICIES.with(|policies| policies.get(&uri));
+
+    // Avoid redundant preference updates in the web process.
+    if settings.enables_javascript() != policy.javascript {
+        settings.set_enable_javascript(policy.javascript);
+    }
+    let low_power = profile == EngineProfile::LowPower;
+    let webgl = policy.webgl && !low_power;
+    if settings.enables_webgl() != webgl {
+        settings.set_enable_webgl(webgl);
+    }
+    let requires_gesture = !policy.autoplay || low_power || data_saver;
+    if settings.is_media_playback_requires_user_gesture() != requires_gesture {
+        settings.set_media_playback_requires_user_gesture(requires_gesture);
+    }
+}
+
+/// Update whether the current page is cached when navigating away from it.
+///
+/// Caching is suspended while system memory is low, since cached pages keep
+/// their entire DOM and JavaScript heap alive.
+fn apply_page_cache(web_view: &WebView, config: PageCacheConfig) {
+    let settings = match web_view.settings() {
+        Some(settings) => settings,
+        None => return,
+    };
+
+    let low_memory =
+        memory::available_mb().map_or(false, |available| available < config.min_memory_mb);
+    let enabled = config.enabled && !low_memory;
+
+    // Avoid redundant preference updates in the web process.
+    if settings.enables_page_cache() != enabled {
+        settings.set_enable_page_cache(enabled);
+    }
+}
+
+/// Page cache usage of back/forward navigations.
+#[derive(Copy, Clone, Default)]
+struct PageCacheStats {
+    restored: u32,
+    reloaded: u32,
+}
+
+/// Report back/forward navigations restored from or missing the page cache.
+fn track_page_cache(content_manager: &UserContentManager) {
+    let handlers = [(PAGE_CACHE_RESTORED_HANDLER, true), (PAGE_CACHE_RELOADED_HANDLER, false)];
+    for (handler, restored) in handlers {
+        content_manager.register_script_message_handler(handler, Some(SCRIPT_WORLD));
+        content_manager.connect_script_message_received(Some(handler), move |_, _| {
+            let mut stats = PAGE_CACHE_STATS.get();
+            if restored {
+                stats.restored += 1;
+            } else {
+                stats.reloaded += 1;
+            }
+            PAGE_CACHE_STATS.set(stats);
+
+            let total = stats.restored + stats.reloaded;
+            info!(
+                "Back/forward navigation {}; {}/{total} restored from page cache",
+                if restored { "restored" } else { "reloaded" },
+                stats.restored,
+            );
+        });
+    }
+
+    let script = UserScript::for_world(
+        PAGE_CACHE_SCRIPT,
+        UserContentInjectedFrames::TopFrame,
+        UserScriptInjectionTime::Start,
+        SCRIPT_WORLD,
+        &[],
+        &[],
+    );
+    content_manager.add_script(&script);
+}
+
+/// Track pinch zoom state reported by the pinch script.
+fn track_pinch(
+    content_manager: &UserContentManager,
+    pinch_previewable: Rc<Cell<bool>>,
+    page_scale: Rc<Cell<f64>>,
+) {
+    content_manager.register_script_message_handler(PINCH_PREVIEW_HANDLER, Some(SCRIPT_WORLD));
+    content_manager.connect_script_message_received(
+        Some(PINCH_PREVIEW_HANDLER),
+        move |_, value| {
+            if value.is_boolean() {
+                pinch_previewable.set(value.to_boolean());
+            }
+        },
+    );
+
+    content_manager.register_script_message_handler(PAGE_SCALE_HANDLER, Some(SCRIPT_WORLD));
+    content_manager.connect_script_message_received(Some(PAGE_SCALE_HANDLER), move |_, value| {
+        if value.is_number() {
+            page_scale.set(value.to_double());
+        }
+    });
+
+    let script = UserScript::for_world(
+        PINCH_SCRIPT,
+        UserContentInjectedFrames::TopFrame,
+        UserScriptInjectionTime::Start,
+        SCRIPT_WORLD,
+        &[],
+        &[],
+    );
+    content_manager.add_script(&script);
+}
+
+/// Forward load performance metrics reported by the metrics script.
+///
+/// The script is only injected while metrics are enabled, but the handler is
+/// always registered so it can be toggled without recreating the engine.
+fn track_metrics(
+    content_manager: &UserContentManager,
+    queue: StQueueHandle<State>,
+    engine_id: EngineId,
+) {
+    content_manager.register_script_message_handler(METRICS_HANDLER, Some(SCRIPT_WORLD));
+    content_manager.connect_script_message_received(Some(METRICS_HANDLER), move |_, value| {
+        match parse_page_metrics(value) {
+            Some(metrics) => queue.clone().set_page_metrics(engine_id, metrics),
+            None => warn!("Ignoring invalid page metrics message"),
+        }
+    });
+}
+
+/// Convert a metrics script message to page metrics.
+fn parse_page_metrics(value: &JscValue) -> Option<PageMetrics> {
+    if !value.is_object() {
+        return None;
+    }
+
+    let uri = value.object_get_property("uri")?.to_str().to_string();
+
+    // Navigation Timing uses `0` for events which have not happened yet.
+    let timing = |name: &str| {
+        let timing = value.object_get_property(name).filter(|timing| timing.is_number())?;
+        Some(timing.to_double()).filter(|timing| *timing > 0.)
+    };
+
+    Some(PageMetrics {
+        uri,
+        engine_version: engine_version(),
+        time_to_first_byte: timing("responseStart"),
+        dom_content_loaded: timing("domContentLoaded"),
+        load: timing("load"),
+        first_contentful_paint: timing("firstContentfulPaint"),
+        largest_contentful_paint: timing("largestContentfulPaint"),
+    })
+}
+
+/// Get the name and version of the WebKit library in use.
+fn engine_version() -> String {
+    let (major, minor, micro) =
+        (wpe_webkit::major_version(), wpe_webkit::minor_version(), wpe_webkit::micro_version());
+    format!("WPE WebKit {major}.{minor}.{micro}")
+}
+
 /// Load the content filter for adblocking.
 fn load_adblock(web_view: WebView) {
+    let rules = Bytes::from_static(include_bytes!("../../../adblock.json"));
+    load_content_filter(ADBLOCK_FILTER_ID, rules, move |filter| {
+        let content_manager = web_view.user_content_manager().unwrap();
+        content_manager.add_filter(&filter);
+    });
+}
+
+/// Load the content filter blocking images and fonts for the data-saver.
+///
+/// The filter is only added if the data-saver is still enabled once loading
+/// has completed.
+fn load_data_saver(web_view: WebView, enabled: Rc<Cell<bool>>) {
+    let rules = Bytes::from_static(include_bytes!("../../../data_saver.json"));
+    load_content_filter(DATA_SAVER_FILTER_ID, rules, move |filter| {
+        if enabled.get() {
+            let content_manager = web_view.user_content_manager().unwrap();
+            content_manager.add_filter(&filter);
+        }
+    });
+}
+
+/// Load a bundled content filter.
+///
+/// Compiled filters are cached on disk and shared between all engines.
+fn load_content_filter<F>(id: &'static str, rules: Bytes, callback: F)
+where
+    F: FnOnce(UserContentFilter) + 'static,
+{
+    // Reuse the filter if it was already loaded by a previous engine.
+    if let Some(filter) = CONTENT_FILTERS.with_borrow(|filters| filters.get(id).cloned()) {
+        callback(filter);
+        return;
+    }
+
     // Initialize content filter cache at the default user data directory.
     let filter_dir = match dirs::data_dir() {
         Some(data_dir) => data_dir.join("kumo/default/content_filters"),
         None => {
-            warn!("Missing user data directory, skipping adblock setup");
+            warn!("Missing user data directory, skipping {id} filter setup");
             return;
         },
     };
     let filter_store = match filter_dir.to_str() {
         Some(filter_dir) => UserContentFilterStore::new(filter_dir),
         None => {
-            warn!("Non-utf8 user data directory ({filter_dir:?}), skipping adblock setup");
+            warn!("Non-utf8 user data directory ({filter_dir:?}), skipping {id} filter setup");
             return;
         },
     };
 
-    // Attempt to load the adblock filter from the cache.
-    filter_store.clone().load(ADBLOCK_FILTER_ID, None::<&Cancellable>, move |filter| {
-        let content_manager = web_view.user_content_manager().unwrap();
-
-        // If the filter was in the cache, just add it to the content manager.
+    // Attempt to load the filter from the cache.
+    filter_store.clone().load(id, None::<&Cancellable>, move |filter| {
+        // If the filter was in the cache, just hand it to the callback.
         if let Ok(filter) = filter {
-            content_manager.add_filter(&filter);
-            trace!("Successfully initialized adblock filter from cache");
+            CONTENT_FILTERS.with_borrow_mut(|filters| filters.insert(id, filter.clone()));
+            trace!("Successfully initialized {id} filter from cache");
+            callback(filter);
             return;
         }
 
-        // Load filter into the cache, then add it to the content manager.
-        let filter_bytes = Bytes::from_static(include_bytes!("../../../adblock.json"));
-        filter_store.save(ADBLOCK_FILTER_ID, &filter_bytes, None::<&Cancellable>, move |filter| {
-            match filter {
-                Ok(filter) => content_manager.add_filter(&filter),
-                Err(err) => error!("Could not load adblock filter: {err}"),
-            }
+        // Load filter into the cache, then hand it to the callback.
+        filter_store.save(id, &rules, None::<&Cancellable>, move |filter| match filter {
+            Ok(filter) => {
+                CONTENT_FILTERS.with_borrow_mut(|filters| filters.insert(id, filter.clone()));
+                callback(filter);
+            },
+            Err(err) => error!("Could not load {id} filter: {err}"),
         });
     });
 }
@@ -0,0 +1,234 @@
+//! Website data storage budgets.
+
+use std::collections::HashMap;
+use std::rc::Rc;
+use std::time::{Duration, Instant};
+
+use funq::StQueueHandle;
+use gio::Cancellable;
+use glib::{source, ControlFlow, Priority};
+use tracing::{error, info};
+use wpe_webkit::{WebsiteData, WebsiteDataManager, WebsiteDataManagerExtManual, WebsiteDataTypes};
+
+use crate::engine::webkit::NETWORK_SESSION;
+use crate::State;
+
+/// Minimum interval between website data cleanups.
+const CLEANUP_INTERVAL: Duration = Duration::from_secs(10 * 60);
+
+/// Time without Wayland activity before the browser is considered idle.
+const QUIET_PERIOD: Duration = Duration::from_secs(30);
+
+#[funq::callbacks(State)]
+pub trait StorageHandler {
+    /// Schedule cleanup if it is due and the browser is idle.
+    fn check_storage_cleanup(&mut self);
+
+    /// Evict website data exceeding the storage budgets.
+    fn clean_storage(&mut self);
+}
+
+impl StorageHandler for State {
+    fn check_storage_cleanup(&mut self) {
+        let now = Instant::now();
+        if !self.storage_cleanup.due(now) {
+            return;
+        }
+        self.storage_cleanup.last_cleanup = now;
+
+        // Only evict once no other events are pending.
+        let mut queue = self.queue.clone();
+        source::idle_add_local_once(move || queue.clean_storage());
+    }
+
+    fn clean_storage(&mut self) {
+        let manager = match NETWORK_SESSION.with(|session| session.website_data_manager()) {
+            Some(manager) if !manager.is_ephemeral() => manager,
+            _ => return,
+        };
+
+        let site_visits = Rc::new(site_visits(&self.history.host_visits()));
+        let config = self.config.storage;
+
+        // HTTP cache size is known, so it is limited to a size in bytes.
+        let disk_cache_budget = config.disk_cache_mb * 1024 * 1024;
+        enforce_budget(&manager, WebsiteDataTypes::DISK_CACHE, disk_cache_budget, &site_visits);
+
+        // Other data types are limited to a number of sites.
+        let site_budgets = [
+            (WebsiteDataTypes::LOCAL_STORAGE, config.local_storage_sites),
+            (WebsiteDataTypes::INDEXEDDB_DATABASES, config.indexeddb_sites),
+            (WebsiteDataTypes::SERVICE_WORKER_REGISTRATIONS, config.service_worker_sites),
+        ];
+        for (types, budget) in site_budgets {
+            enforce_budget(&manager, types, budget as u64, &site_visits);
+        }
+    }
+}
+
+/// Periodically clean up website data while the browser is idle.
+pub fn schedule_cleanup(mut queue: StQueueHandle<State>) {
+    // Low priority ensures that cleanup never delays input or rendering.
+    let interval = QUIET_PERIOD.as_secs() as u32;
+    source::timeout_add_seconds_local_full(interval, Priority::LOW, move || {
+        queue.check_storage_cleanup();
+        ControlFlow::Continue
+    });
+}
+
+/// Website data cleanup scheduling.
+///
+/// Cleanup runs at most once per [`CLEANUP_INTERVAL`], after the browser has
+/// been without input and rendering for [`QUIET_PERIOD`].
+#[derive(Debug)]
+pub struct StorageCleanup {
+    last_cleanup: Instant,
+    last_activity: Instant,
+}
+
+impl Default for StorageCleanup {
+    fn default() -> Self {
+        let now = Instant::now();
+        Self { last_cleanup: now, last_activity: now }
+    }
+}
+
+impl StorageCleanup {
+    /// Delay cleanup until the browser is idle again.
+    pub fn activity(&mut self) {
+        self.last_activity = Instant::now();
+    }
+
+    /// Check whether cleanup should be run.
+    fn due(&self, now: Instant) -> bool {
+        now.duration_since(self.last_cleanup) >= CLEANUP_INTERVAL
+            && now.duration_since(self.last_activity) >= QUIET_PERIOD
+    }
+}
+
+/// Remove the least recently visited sites exceeding a data type's budget.
+///
+/// For [`WebsiteDataTypes::DISK_CACHE`] the budget is in bytes, for all other
+/// types it is the maximum number of sites. A budget of `0` is unlimited.
+fn enforce_budget(
+    manager: &WebsiteDataManager,
+    types: WebsiteDataTypes,
+    budget: u64,
+    site_visits: &Rc<HashMap<String, i64>>,
+) {
+    if budget == 0 {
+        return;
+    }
+
+    let site_visits = site_visits.clone();
+    let remove_manager = manager.clone();
+    manager.fetch(types, None::<&Cancellable>, move |data| {
+        let data = match data {
+            Ok(data) => data,
+            Err(err) => {
+                error!("Could not fetch website data ({types:?}): {err}");
+                return;
+            },
+        };
+
+        // WebKit only knows the size of the HTTP cache, so other types are counted.
+        let sites: Vec<_> = data
+            .iter()
+            .map(|data| {
+                let last_visit = data.name().and_then(|name| site_visits.get(name.as_str()));
+                let size = if types == WebsiteDataTypes::DISK_CACHE { data.size(types) } else { 1 };
+                (last_visit.copied().unwrap_or_default(), size)
+            })
+            .collect();
+
+        let evicted: Vec<&WebsiteData> =
+            evictions(&sites, budget).into_iter().map(|index| &data[index]).collect();
+        if evicted.is_empty() {
+            return;
+        }
+
+        info!("Evicting {} sites exceeding the {types:?} budget", evicted.len());
+
+        remove_manager.remove(types, &evicted, None::<&Cancellable>, move |result| {
+            if let Err(err) = result {
+                error!("Could not remove website data ({types:?}): {err}");
+            }
+        });
+    });
+}
+
+/// Get the indices of sites which need to be removed to fit the budget.
+///
+/// Sites are passed as `(last_visit, size)` and evicted starting with the
+/// least recently visited one.
+fn evictions(sites: &[(i64, u64)], budget: u64) -> Vec<usize> {
+    let mut total: u64 = sites.iter().map(|(_, size)| size).sum();
+
+    let mut indices: Vec<_> = (0..sites.len()).collect();
+    indices.sort_by_key(|&index| sites[index].0);
+
+    indices
+        .into_iter()
+        .take_while(|&index| {
+            let over_budget = total > budget;
+            total -= sites[index].1;
+            over_budget
+        })
+        .collect()
+}
+
+/// Convert last visit times per host to last visit times per site.
+///
+/// WebKit groups website data by registrable domain, so every parent domain of
+/// a host is considered visited as well.
+fn site_visits(host_visits: &HashMap<String, i64>) -> HashMap<String, i64> {
+    let mut site_visits: HashMap<String, i64> = HashMap::new();
+
+    for (host, &last_visit) in host_visits {
+        let mut domain = host.as_str();
+        loop {
+            let site_visit = site_visits.entry(domain.into()).or_default();
+            *site_visit = (*site_visit).max(last_visit);
+
+            match domain.split_once('.') {
+                Some((_, parent)) if !parent.is_empty() => domain = parent,
+                _ => break,
+            }
+        }
+    }
+
+    site_visits
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn lru_evictions() {
+        let sites = [(30, 10), (10, 10), (20, 10), (40, 10)];
+
+        assert_eq!(evictions(&sites, 40), Vec::<usize>::new());
+        assert_eq!(evictions(&sites, 30), vec![1]);
+        assert_eq!(evictions(&sites, 15), vec![1, 2, 0]);
+        assert_eq!(evictions(&sites, 1), vec![1, 2, 0, 3]);
+
+        // Sizes are subtracted until the remaining sites fit.
+        let sites = [(1, 100), (2, 1), (3, 1)];
+        assert_eq!(evictions(&sites, 10), vec![0]);
+    }
+
+    #[test]
+    fn parent_domain_visits() {
+        let mut host_visits = HashMap::new();
+        host_visits.insert("www.example.org".into(), 5);
+        host_visits.insert("cdn.example.org".into(), 7);
+        host_visits.insert("localhost".into(), 3);
+
+        let site_visits = site_visits(&host_visits);
+        assert_eq!(site_visits.get("example.org"), Some(&7));
+        assert_eq!(site_visits.get("www.example.org"), Some(&5));
+        assert_eq!(site_visits.get("localhost"), Some(&3));
+        assert_eq!(site_visits.get("other.org"), None);
+    }
+}
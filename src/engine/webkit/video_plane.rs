@@ -0,0 +1,135 @@
+//! Hole-punched video planes.
+//!
+//! With WPE's video plane support, WebKit's GStreamer player leaves a
+//! transparent hole in the page instead of compositing video into the engine
+//! buffer, exporting the decoded frames as dmabufs. These are shown on a
+//! separate subsurface below the engine surface, allowing the compositor to
+//! put them directly on a hardware plane.
+
+use std::ffi;
+use std::os::fd::{FromRawFd, OwnedFd};
+
+use funq::StQueueHandle;
+use wpe_backend_fdo_sys::{
+    wpe_video_plane_display_dmabuf_export, wpe_video_plane_display_dmabuf_export_release,
+    wpe_video_plane_display_dmabuf_receiver, wpe_video_plane_display_dmabuf_register_receiver,
+};
+
+use crate::wayland::protocols::dmabuf::{DmabufBuffer, DmabufPlane};
+use crate::window::Window;
+use crate::{Position, Size, State};
+
+/// DRM fourcc format of video frames, `YUYV`.
+const VIDEO_FORMAT: u32 = u32::from_le_bytes(*b"YUYV");
+
+/// DRM format modifier of video frames, `DRM_FORMAT_MOD_LINEAR`.
+const VIDEO_MODIFIER: u64 = 0;
+
+#[funq::callbacks(State, thread_local)]
+trait VideoPlaneHandler {
+    /// Show a new frame of a video.
+    fn set_video_frame(&mut self, frame: VideoFrame);
+
+    /// Remove a video's plane.
+    fn end_video(&mut self, video_id: u32);
+}
+
+impl VideoPlaneHandler for State {
+    fn set_video_frame(&mut self, frame: VideoFrame) {
+        if let Some(window) = self.video_window() {
+            window.set_video_frame(frame);
+        }
+    }
+
+    fn end_video(&mut self, video_id: u32) {
+        for window in self.windows.values_mut() {
+            window.end_video(video_id);
+        }
+    }
+}
+
+impl State {
+    /// Get the window responsible for video planes.
+    ///
+    /// WebKit does not report which web view a video belongs to, so videos are
+    /// shown in the focused window.
+    fn video_window(&mut self) -> Option<&mut Window> {
+        let window_id = self.keyboard_focus.or_else(|| self.windows.keys().next().copied())?;
+        self.windows.get_mut(&window_id)
+    }
+}
+
+/// Decoded video frame exported by WebKit.
+///
+/// The frame is returned to the video decoder once it is dropped.
+#[derive(Debug)]
+pub struct VideoFrame {
+    pub video_id: u32,
+    /// Frame position in engine buffer pixels.
+    pub position: Position,
+    pub buffer: DmabufBuffer,
+    export: *mut wpe_video_plane_display_dmabuf_export,
+}
+
+// Frames are only created and dropped on the main thread, but Wayland buffer
+// user data must be thread-safe.
+unsafe impl Send for VideoFrame {}
+unsafe impl Sync for VideoFrame {}
+
+impl Drop for VideoFrame {
+    fn drop(&mut self) {
+        unsafe { wpe_video_plane_display_dmabuf_export_release(self.export) };
+    }
+}
+
+/// Start receiving hole-punched video frames.
+///
+/// This must only be called once, after WPEBackend-fdo was initialized.
+pub fn register_receiver(queue: StQueueHandle<State>) {
+    let receiver = wpe_video_plane_display_dmabuf_receiver {
+        handle_dmabuf: Some(on_video_dmabuf),
+        end_of_stream: Some(on_video_end_of_stream),
+        _wpe_reserved0: None,
+        _wpe_reserved1: None,
+        _wpe_reserved2: None,
+    };
+
+    let receiver = Box::into_raw(Box::new(receiver));
+    let queue = Box::into_raw(Box::new(queue));
+    unsafe { wpe_video_plane_display_dmabuf_register_receiver(receiver, queue.cast()) };
+}
+
+/// Handle a new video frame.
+#[allow(clippy::too_many_arguments)]
+unsafe extern "C" fn on_video_dmabuf(
+    queue: *mut ffi::c_void,
+    export: *mut wpe_video_plane_display_dmabuf_export,
+    video_id: u32,
+    fd: ffi::c_int,
+    x: i32,
+    y: i32,
+    width: i32,
+    height: i32,
+    stride: u32,
+) {
+    let plane = DmabufPlane { fd: OwnedFd::from_raw_fd(fd), offset: 0, stride };
+    let buffer = DmabufBuffer {
+        size: Size::new(width.max(0) as u32, height.max(0) as u32),
+        format: VIDEO_FORMAT,
+        modifier: VIDEO_MODIFIER,
+        planes: vec![plane],
+    };
+    let frame = VideoFrame { video_id, position: Position::new(x, y), buffer, export };
+
+    // Release the frame immediately if there's no queue to handle it.
+    if let Some(queue) = queue.cast::<StQueueHandle<State>>().as_mut() {
+        queue.set_video_frame(frame);
+    }
+}
+
+/// Handle the end of a video.
+unsafe extern "C" fn on_video_end_of_stream(queue: *mut ffi::c_void, video_id: u32) {
+    if let Some(queue) = queue.cast::<StQueueHandle<State>>().as_mut() {
+        queue.end_video(video_id);
+    }
+}
@@ -5,11 +5,14 @@ use std::fs;
 use std::path::Path;
 use std::rc::Rc;
 use std::sync::RwLock;
+use std::time::{SystemTime, UNIX_EPOCH};
 
 use rusqlite::Connection as SqliteConnection;
 use smallvec::SmallVec;
 use tracing::error;
 
+use crate::engine::PageMetrics;
+
 /// Maximum scored history matches compared.
 pub const MAX_MATCHES: usize = 25;
 
@@ -59,7 +62,7 @@ impl History {
 
         // Update filesystem history.
         if let Some(db) = &self.db {
-            if let Err(err) = db.visit(&uri) {
+            if let Err(err) = db.visit(&uri, history_uri.host()) {
                 error!("Failed to write URI to history: {err}");
             }
         }
@@ -93,6 +96,15 @@ impl History {
         }
     }
 
+    /// Store load performance metrics of a page.
+    pub fn record_metrics(&self, metrics: &PageMetrics) {
+        if let Some(db) = &self.db {
+            if let Err(err) = db.record_metrics(metrics) {
+                error!("Failed to write page metrics to history: {err}");
+            }
+        }
+    }
+
     /// Get autocomplete suggestion for an input.
     pub fn autocomplete(&self, input: &str) -> Option<String> {
         // Question marks suggest query parameters or search engine query, neither has
@@ -117,6 +129,22 @@ impl History {
         Some(uri.to_string(!input_uri.scheme.is_empty()))
     }
 
+    /// Get the last visit time for every host, in seconds since the Unix epoch.
+    pub fn host_visits(&self) -> HashMap<String, i64> {
+        let db = match &self.db {
+            Some(db) => db,
+            None => return HashMap::new(),
+        };
+
+        match db.host_visits() {
+            Ok(host_visits) => host_visits,
+            Err(err) => {
+                error!("Could not load host visits: {err}");
+                HashMap::new()
+            },
+        }
+    }
+
     /// Get history matches for the input in ascending relevance.
     pub fn matches(&self, input: &str) -> SmallVec<[HistoryMatch; MAX_MATCHES]> {
         // Empty input always results in no matches.
@@ -142,6 +170,7 @@ impl History {
                 (score != 0).then(|| HistoryMatch {
                     score,
                     title: entry.title.clone(),
+                    views: entry.views,
                     uri: uri_str,
                 })
             })
@@ -178,6 +207,27 @@ impl HistoryDb {
             )",
             [],
         )?;
+        connection.execute(
+            "CREATE TABLE IF NOT EXISTS hosts (
+                host TEXT NOT NULL PRIMARY KEY,
+                last_visit INTEGER NOT NULL
+            )",
+            [],
+        )?;
+        connection.execute(
+            "CREATE TABLE IF NOT EXISTS page_metrics (
+                uri TEXT NOT NULL,
+                time INTEGER NOT NULL,
+                kumo_version TEXT NOT NULL,
+                engine_version TEXT NOT NULL,
+                time_to_first_byte REAL,
+                dom_content_loaded REAL,
+                load REAL,
+                first_contentful_paint REAL,
+                largest_contentful_paint REAL
+            )",
+            [],
+        )?;
 
         Ok(Self { connection })
     }
@@ -197,14 +247,30 @@ impl HistoryDb {
         Ok(history)
     }
 
+    /// Load last visit times for all hosts.
+    fn host_visits(&self) -> rusqlite::Result<HashMap<String, i64>> {
+        let mut statement = self.connection.prepare("SELECT host, last_visit FROM hosts")?;
+        let host_visits =
+            statement.query_map([], |row| Ok((row.get(0)?, row.get(1)?)))?.flatten().collect();
+        Ok(host_visits)
+    }
+
     /// Increment visits for a page.
-    fn visit(&self, uri: &str) -> rusqlite::Result<()> {
+    fn visit(&self, uri: &str, host: &str) -> rusqlite::Result<()> {
         self.connection.execute(
             "INSERT INTO history (uri) VALUES (?1)
                 ON CONFLICT (uri) DO UPDATE SET views=views+1",
             [uri],
         )?;
 
+        // Track host access times for website data cleanup.
+        let now = SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or_default().as_secs();
+        self.connection.execute(
+            "INSERT INTO hosts (host, last_visit) VALUES (?1, ?2)
+                ON CONFLICT (host) DO UPDATE SET last_visit=?2",
+            (host, now as i64),
+        )?;
+
         Ok(())
     }
 
@@ -214,12 +280,37 @@ impl HistoryDb {
 
         Ok(())
     }
+
+    /// Add load performance metrics for a page.
+    fn record_metrics(&self, metrics: &PageMetrics) -> rusqlite::Result<()> {
+        let now = SystemTime::now().duration_since(UNIX_EPOCH).unwrap_or_default().as_secs();
+        self.connection.execute(
+            "INSERT INTO page_metrics (
+                uri, time, kumo_version, engine_version, time_to_first_byte,
+                dom_content_loaded, load, first_contentful_paint, largest_contentful_paint
+            ) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)",
+            (
+                &metrics.uri,
+                now as i64,
+                env!("CARGO_PKG_VERSION"),
+                &metrics.engine_version,
+                metrics.time_to_first_byte,
+                metrics.dom_content_loaded,
+                metrics.load,
+                metrics.first_contentful_paint,
+                metrics.largest_contentful_paint,
+            ),
+        )?;
+
+        Ok(())
+    }
 }
 
 /// Match for a history query.
 pub struct HistoryMatch {
     pub uri: String,
     pub title: String,
+    pub views: u32,
     score: usize,
 }
 
@@ -262,6 +353,15 @@ impl HistoryUri {
         Self { base, path, scheme: scheme.into() }
     }
 
+    /// Get the URI's host, without port.
+    fn host(&self) -> &str {
+        match self.base.rfind(':') {
+            // Ignore colons which are part of an IPv6 address.
+            Some(index) if !self.base[index..].contains(']') => &self.base[..index],
+            _ => &self.base,
+        }
+    }
+
     /// Get autocomplete suggestion for this URI.
     fn autocomplete(&self, input_uri: &HistoryUri) -> bool {
         // Ignore exact matches, since there's nothing to complete.
@@ -427,4 +527,12 @@ mod tests {
         assert!(uri.autocomplete(&"example.org/path/segments".into()));
         assert!(!uri.autocomplete(&"other.org/p".into()));
     }
+
+    #[test]
+    fn history_uri_host() {
+        assert_eq!(HistoryUri::new("https://example.org/path").host(), "example.org");
+        assert_eq!(HistoryUri::new("http://example.org:8080/").host(), "example.org");
+        assert_eq!(HistoryUri::new("http://[::1]:8080/").host(), "[::1]");
+        assert_eq!(HistoryUri::new("http://[::1]/").host(), "[::1]");
+    }
 }
@@ -0,0 +1,574 @@
+//! Input event tracking.
+
+use std::mem;
+use std::ops::RangeInclusive;
+
+use smithay_client_toolkit::seat::keyboard::Modifiers;
+use smithay_client_toolkit::seat::pointer::AxisScroll;
+
+use crate::{Position, Size};
+
+/// Maximum number of simultaneously tracked touch points.
+pub const MAX_TOUCH_POINTS: usize = 10;
+
+/// Time in milliseconds subtracted from the resampling target.
+///
+/// This trades a bit of latency for interpolating between real samples more
+/// often, instead of extrapolating.
+pub const RESAMPLE_LATENCY: u32 = 5;
+
+/// Maximum time in milliseconds a touch position is extrapolated.
+const MAX_PREDICTION: i64 = 8;
+
+/// Minimum time in milliseconds between samples used for resampling.
+///
+/// Samples which are closer together are too noisy to extrapolate from.
+const MIN_RESAMPLE_DELTA: i64 = 2;
+
+/// Maximum time in milliseconds between samples used for resampling.
+const MAX_RESAMPLE_DELTA: i64 = 20;
+
+/// Minimum relative distance change for a pinch to change the page scale.
+const MIN_PINCH_SCALE_CHANGE: f64 = 0.01;
+
+/// Range of accepted frame intervals in milliseconds.
+///
+/// Intervals outside of this range are caused by rendering stalls.
+const FRAME_INTERVAL_RANGE: RangeInclusive<u32> = 4..=50;
+
+/// Maximum difference in milliseconds between an event's timestamp and its
+/// arrival, for both to be considered to use the same clock.
+const CLOCK_TOLERANCE: u32 = 1000;
+
+/// Active touch points.
+///
+/// Touch points are stored in fixed slots to avoid allocations while
+/// touch input is ongoing.
+#[derive(Clone, Default, Debug)]
+pub struct TouchPoints {
+    slots: [Option<TouchPoint>; MAX_TOUCH_POINTS],
+}
+
+impl TouchPoints {
+    /// Add a touch point or update its position.
+    ///
+    /// New touch points are ignored once all slots are occupied.
+    pub fn insert(&mut self, id: i32, time: u32, position: Position<f64>) {
+        // Update existing touch point.
+        if let Some(point) = self.slots.iter_mut().flatten().find(|point| point.id == id) {
+            // Keep the previous sample for resampling.
+            if time != point.time {
+                point.previous = Some((point.time, point.position));
+            }
+
+            point.position = position;
+            point.time = time;
+            return;
+        }
+
+        // Add touch point to the first free slot.
+        if let Some(slot) = self.slots.iter_mut().find(|slot| slot.is_none()) {
+            *slot = Some(TouchPoint { id, time, position, previous: None });
+        }
+    }
+
+    /// Remove a touch point.
+    pub fn remove(&mut self, id: i32) {
+        for slot in &mut self.slots {
+            if slot.map_or(false, |point| point.id == id) {
+                *slot = None;
+            }
+        }
+    }
+
+    /// Get a touch point's position.
+    pub fn get(&self, id: i32) -> Option<Position<f64>> {
+        self.iter().find(|point| point.id == id).map(|point| point.position)
+    }
+
+    /// Iterate over all active touch points.
+    pub fn iter(&self) -> impl Iterator<Item = &TouchPoint> {
+        self.slots.iter().flatten()
+    }
+
+    /// Get touch points with positions resampled for a target time.
+    pub fn resampled(&self, time: u32) -> Self {
+        let mut touch_points = self.clone();
+        for point in touch_points.slots.iter_mut().flatten() {
+            point.position = point.resample(time);
+        }
+        touch_points
+    }
+}
+
+/// Single touch point.
+#[derive(Copy, Clone, PartialEq, Debug)]
+pub struct TouchPoint {
+    pub id: i32,
+    pub position: Position<f64>,
+    time: u32,
+    previous: Option<(u32, Position<f64>)>,
+}
+
+impl TouchPoint {
+    /// Estimate the touch position at a specific time.
+    ///
+    /// The position is interpolated between the last two samples, or
+    /// extrapolated from them for a limited time.
+    fn resample(&self, time: u32) -> Position<f64> {
+        let (prev_time, prev_position) = match self.previous {
+            Some(previous) => previous,
+            None => return self.position,
+        };
+
+        // Ignore samples which are unsuitable for resampling.
+        let delta = self.time.wrapping_sub(prev_time) as i32 as i64;
+        if !(MIN_RESAMPLE_DELTA..=MAX_RESAMPLE_DELTA).contains(&delta) {
+            return self.position;
+        }
+
+        // Limit prediction to half the sample distance, to reduce overshoot.
+        let max_prediction = MAX_PREDICTION.min(delta / 2);
+        let offset = (time.wrapping_sub(prev_time) as i32 as i64).clamp(0, delta + max_prediction);
+
+        let alpha = offset as f64 / delta as f64;
+        let x = prev_position.x + (self.position.x - prev_position.x) * alpha;
+        let y = prev_position.y + (self.position.y - prev_position.y) * alpha;
+        Position::new(x, y)
+    }
+}
+
+/// Compositor frame timing estimation.
+///
+/// Resampling compares touch timestamps against the expected presentation
+/// time, so both must use the same clock. Wayland leaves the base of input and
+/// frame callback timestamps undefined, so they are checked against the
+/// presentation clock (or `CLOCK_MONOTONIC` without `wp_presentation`) on
+/// arrival, and resampling is disabled when they do not match.
+#[derive(Default, Debug)]
+pub struct FrameClock {
+    last_frame: Option<u32>,
+    interval: Option<f64>,
+    /// Last presentation time reported by the compositor.
+    last_presentation: Option<u32>,
+    /// Output refresh interval in milliseconds.
+    refresh: Option<f64>,
+    /// Clock of presentation timestamps.
+    clock_id: Option<libc::clockid_t>,
+    /// Whether frame callback timestamps use the presentation clock.
+    frame_clock_matches: bool,
+    /// Whether input timestamps use the presentation clock.
+    input_clock_matches: bool,
+}
+
+impl FrameClock {
+    /// Record the time of a new frame callback.
+    pub fn frame(&mut self, time: u32) {
+        if let Some(now) = self.now() {
+            self.frame_at(time, now);
+        }
+    }
+
+    /// Record the presentation time of a frame.
+    ///
+    /// The `refresh` interval is in nanoseconds, with zero if it is unknown.
+    pub fn presented(&mut self, time: u32, refresh: u32) {
+        self.last_presentation = Some(time);
+        self.refresh = (refresh != 0).then_some(refresh as f64 / 1_000_000.);
+    }
+
+    /// Record the time of an input event.
+    pub fn input(&mut self, time: u32) {
+        if let Some(now) = self.now() {
+            self.input_clock_matches = clock_matches(time, now);
+        }
+    }
+
+    /// Set the clock used for presentation timestamps.
+    pub fn set_clock(&mut self, clock_id: libc::clockid_t) {
+        self.clock_id = Some(clock_id);
+    }
+
+    /// Expected presentation time of the next frame.
+    pub fn next_presentation(&self) -> Option<u32> {
+        self.next_presentation_at(self.now()?)
+    }
+
+    fn frame_at(&mut self, time: u32, now: u32) {
+        if let Some(last_frame) = self.last_frame {
+            let delta = time.wrapping_sub(last_frame);
+            if FRAME_INTERVAL_RANGE.contains(&delta) {
+                // Smooth out jitter in frame callback times.
+                let delta = delta as f64;
+                let interval = self.interval.map_or(delta, |interval| interval * 0.9 + delta * 0.1);
+                self.interval = Some(interval);
+            }
+        }
+        self.last_frame = Some(time);
+        self.frame_clock_matches = clock_matches(time, now);
+    }
+
+    fn next_presentation_at(&self, now: u32) -> Option<u32> {
+        // Resampling against a different clock would use arbitrary offsets.
+        if !self.input_clock_matches {
+            return None;
+        }
+
+        // Prefer the first vblank after now, using exact presentation feedback.
+        if let (Some(last_presentation), Some(refresh)) = (self.last_presentation, self.refresh) {
+            let elapsed = now.wrapping_sub(last_presentation);
+            if elapsed <= CLOCK_TOLERANCE {
+                let frames = (elapsed as f64 / refresh).floor() + 1.;
+                return Some(last_presentation.wrapping_add((frames * refresh).round() as u32));
+            }
+        }
+
+        // Fall back to estimating from frame callbacks.
+        if !self.frame_clock_matches {
+            return None;
+        }
+        let interval = self.interval?.round() as u32;
+        Some(self.last_frame?.wrapping_add(interval))
+    }
+
+    /// Current time of the presentation clock in milliseconds.
+    fn now(&self) -> Option<u32> {
+        let clock_id = self.clock_id.unwrap_or(libc::CLOCK_MONOTONIC);
+        let mut time = libc::timespec { tv_sec: 0, tv_nsec: 0 };
+        if unsafe { libc::clock_gettime(clock_id, &mut time) } != 0 {
+            return None;
+        }
+        let millis =
+            (time.tv_sec as u64).wrapping_mul(1000).wrapping_add(time.tv_nsec as u64 / 1_000_000);
+        Some(millis as u32)
+    }
+}
+
+/// Check whether a timestamp was taken from the clock reporting `now`.
+fn clock_matches(time: u32, now: u32) -> bool {
+    now.wrapping_sub(time).min(time.wrapping_sub(now)) <= CLOCK_TOLERANCE
+}
+
+/// Two finger pinch gesture.
+///
+/// Pinches are previewed by scaling the last engine buffer, until the engine
+/// has rendered the gesture's latest state.
+#[derive(Copy, Clone, Debug)]
+pub struct Pinch {
+    ids: [i32; 2],
+    /// Gesture geometry matching the engine's current buffer.
+    start: PinchGeometry,
+    /// Latest gesture geometry.
+    current: PinchGeometry,
+    /// Gesture geometry submitted to the engine but not rendered yet, with the
+    /// page scale at the time of submission.
+    pending_commit: Option<(PinchGeometry, f64)>,
+    /// Whether both touch points are still active.
+    active: bool,
+    /// Whether the preview has changed since the last frame.
+    dirty: bool,
+}
+
+impl Pinch {
+    /// Start a new pinch if exactly two touch points are active.
+    pub fn new(touch_points: &TouchPoints) -> Option<Self> {
+        let mut points = touch_points.iter();
+        let (first, second) = (points.next()?, points.next()?);
+        if points.next().is_some() {
+            return None;
+        }
+
+        let geometry = PinchGeometry::new(first.position, second.position);
+        Some(Self {
+            ids: [first.id, second.id],
+            start: geometry,
+            current: geometry,
+            active: true,
+            pending_commit: Default::default(),
+            dirty: Default::default(),
+        })
+    }
+
+    /// Update the gesture with the latest touch point positions.
+    pub fn update(&mut self, touch_points: &TouchPoints) {
+        if let (Some(first), Some(second)) =
+            (touch_points.get(self.ids[0]), touch_points.get(self.ids[1]))
+        {
+            self.current = PinchGeometry::new(first, second);
+            self.dirty = true;
+        }
+    }
+
+    /// Mark the latest gesture state as submitted to the engine.
+    pub fn commit(&mut self, page_scale: f64) {
+        self.pending_commit = Some((self.current, page_scale));
+    }
+
+    /// End the gesture after one of its touch points was released.
+    pub fn end(&mut self, page_scale: f64) {
+        self.active = false;
+        self.commit(page_scale);
+    }
+
+    /// Handle a new engine buffer.
+    ///
+    /// Buffers only reflect the submitted gesture once the page scale has
+    /// changed, since the engine might still be rendering older input.
+    ///
+    /// Returns `false` once the preview is not necessary anymore.
+    pub fn buffer_updated(&mut self, page_scale: f64) -> bool {
+        if let Some((geometry, committed_scale)) = self.pending_commit {
+            let scale_change = geometry.distance / self.start.distance.max(1.) - 1.;
+            if page_scale != committed_scale || scale_change.abs() < MIN_PINCH_SCALE_CHANGE {
+                self.pending_commit = None;
+                self.start = geometry;
+                self.dirty = true;
+            }
+        }
+
+        self.active || self.pending_commit.is_some()
+    }
+
+    /// Check if this gesture uses a touch point.
+    pub fn contains(&self, id: i32) -> bool {
+        self.ids.contains(&id)
+    }
+
+    /// Whether both touch points are still active.
+    pub fn active(&self) -> bool {
+        self.active
+    }
+
+    /// Check and reset the preview's dirtiness.
+    pub fn take_dirty(&mut self) -> bool {
+        mem::take(&mut self.dirty)
+    }
+
+    /// Get the area of the engine buffer visible in the preview.
+    ///
+    /// The `position` and `size` describe the area visible without the pinch,
+    /// the preview never shows anything outside of the buffer's `bounds`.
+    /// All values are in logical engine coordinates.
+    pub fn visible_area(
+        &self,
+        position: Position<f64>,
+        size: Size<f64>,
+        bounds: Size<f64>,
+    ) -> (Position<f64>, Size<f64>) {
+        // Zooming out cannot be previewed without content outside the buffer.
+        let scale = self.current.distance / self.start.distance.max(1.);
+        let scale = if scale.is_finite() { scale.max(1.) } else { 1. };
+
+        // Keep the content below the pinch center in place.
+        let width = size.width / scale;
+        let height = size.height / scale;
+        let x = self.start.center.x + (position.x - self.current.center.x) / scale;
+        let y = self.start.center.y + (position.y - self.current.center.y) / scale;
+
+        let x = x.clamp(0., (bounds.width - width).max(0.));
+        let y = y.clamp(0., (bounds.height - height).max(0.));
+
+        (Position::new(x, y), Size::new(width, height))
+    }
+}
+
+/// Touch point distance and center of a pinch gesture.
+#[derive(Copy, Clone, Debug)]
+struct PinchGeometry {
+    distance: f64,
+    center: Position<f64>,
+}
+
+impl PinchGeometry {
+    fn new(first: Position<f64>, second: Position<f64>) -> Self {
+        let (dx, dy) = (second.x - first.x, second.y - first.y);
+        let distance = (dx * dx + dy * dy).sqrt();
+        let center = Position::new((first.x + second.x) / 2., (first.y + second.y) / 2.);
+        Self { distance, center }
+    }
+}
+
+/// Engine input events coalesced until the next frame.
+#[derive(Default)]
+pub struct PendingInput {
+    pub touch_motion: Option<(u32, i32, Modifiers)>,
+    pub pointer_motion: Option<(u32, Position<f64>, Modifiers)>,
+    pub pointer_axis: Option<PointerAxis>,
+}
+
+impl PendingInput {
+    /// Merge a scroll event into the pending scroll.
+    ///
+    /// Scroll deltas are summed up, while the position and modifiers of the
+    /// latest event are used.
+    pub fn add_pointer_axis(
+        &mut self,
+        time: u32,
+        position: Position<f64>,
+        horizontal: AxisScroll,
+        vertical: AxisScroll,
+        modifiers: Modifiers,
+    ) {
+        match &mut self.pointer_axis {
+            Some(axis) => {
+                axis.time = time;
+                axis.position = position;
+                axis.modifiers = modifiers;
+                merge_axis(&mut axis.horizontal, horizontal);
+                merge_axis(&mut axis.vertical, vertical);
+            },
+            None => {
+                self.pointer_axis =
+                    Some(PointerAxis { time, position, horizontal, vertical, modifiers })
+            },
+        }
+    }
+
+    /// Check if there are no pending events.
+    pub fn is_empty(&self) -> bool {
+        self.touch_motion.is_none() && self.pointer_motion.is_none() && self.pointer_axis.is_none()
+    }
+}
+
+/// Accumulated pointer scroll.
+pub struct PointerAxis {
+    pub time: u32,
+    pub position: Position<f64>,
+    pub horizontal: AxisScroll,
+    pub vertical: AxisScroll,
+    pub modifiers: Modifiers,
+}
+
+/// Add one scroll axis delta to another.
+fn merge_axis(axis: &mut AxisScroll, delta: AxisScroll) {
+    axis.absolute += delta.absolute;
+    axis.stop |= delta.stop;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn touch_point_slots() {
+        let mut touch_points = TouchPoints::default();
+
+        touch_points.insert(3, 0, Position::new(1., 1.));
+        touch_points.insert(7, 0, Position::new(2., 2.));
+        touch_points.insert(3, 1, Position::new(3., 3.));
+        assert_eq!(touch_points.iter().count(), 2);
+        assert_eq!(touch_points.get(3), Some(Position::new(3., 3.)));
+        assert_eq!(touch_points.get(7), Some(Position::new(2., 2.)));
+
+        touch_points.remove(3);
+        assert_eq!(touch_points.get(3), None);
+        assert_eq!(touch_points.iter().count(), 1);
+
+        // Freed slots are reused.
+        for id in 0..MAX_TOUCH_POINTS as i32 + 5 {
+            touch_points.insert(100 + id, 0, Position::default());
+        }
+        assert_eq!(touch_points.iter().count(), MAX_TOUCH_POINTS);
+    }
+
+    #[test]
+    fn touch_resampling() {
+        let mut touch_points = TouchPoints::default();
+        touch_points.insert(0, 100, Position::new(0., 0.));
+
+        // Single samples are not resampled.
+        assert_eq!(touch_points.resampled(120).get(0), Some(Position::new(0., 0.)));
+
+        touch_points.insert(0, 108, Position::new(0., 80.));
+
+        // Interpolation.
+        assert_eq!(touch_points.resampled(104).get(0), Some(Position::new(0., 40.)));
+        assert_eq!(touch_points.resampled(90).get(0), Some(Position::new(0., 0.)));
+
+        // Extrapolation is limited to half the sample distance.
+        assert_eq!(touch_points.resampled(110).get(0), Some(Position::new(0., 100.)));
+        assert_eq!(touch_points.resampled(130).get(0), Some(Position::new(0., 120.)));
+
+        // Samples too far apart are not resampled.
+        touch_points.insert(0, 200, Position::new(0., 200.));
+        assert_eq!(touch_points.resampled(205).get(0), Some(Position::new(0., 200.)));
+    }
+
+    #[test]
+    fn frame_clock() {
+        let mut frame_clock = FrameClock { input_clock_matches: true, ..FrameClock::default() };
+        assert_eq!(frame_clock.next_presentation_at(1000), None);
+
+        frame_clock.frame_at(1000, 1000);
+        frame_clock.frame_at(1016, 1016);
+        assert_eq!(frame_clock.next_presentation_at(1016), Some(1032));
+
+        // Stalls do not affect the interval.
+        frame_clock.frame_at(2000, 2000);
+        assert_eq!(frame_clock.next_presentation_at(2000), Some(2016));
+
+        // Frame callbacks from a different clock are ignored.
+        frame_clock.frame_at(2016, 900_000);
+        assert_eq!(frame_clock.next_presentation_at(900_000), None);
+
+        // Presentation feedback uses the next vblank.
+        frame_clock.presented(899_990, 16_666_666);
+        assert_eq!(frame_clock.next_presentation_at(900_000), Some(900_007));
+        assert_eq!(frame_clock.next_presentation_at(900_020), Some(900_023));
+
+        // Input from a different clock disables resampling.
+        frame_clock.input_clock_matches = clock_matches(5, 900_000);
+        assert_eq!(frame_clock.next_presentation_at(900_000), None);
+    }
+
+    #[test]
+    fn pointer_axis_accumulation() {
+        let mut pending = PendingInput::default();
+        assert!(pending.is_empty());
+
+        let modifiers = Modifiers::default();
+        let scroll = |absolute| AxisScroll { absolute, ..AxisScroll::default() };
+        pending.add_pointer_axis(1, Position::new(1., 1.), scroll(1.), scroll(2.), modifiers);
+        pending.add_pointer_axis(2, Position::new(2., 2.), scroll(3.), scroll(-5.), modifiers);
+
+        let axis = pending.pointer_axis.unwrap();
+        assert_eq!(axis.time, 2);
+        assert_eq!(axis.position, Position::new(2., 2.));
+        assert_eq!(axis.horizontal.absolute, 4.);
+        assert_eq!(axis.vertical.absolute, -3.);
+    }
+
+    #[test]
+    fn pinch_preview() {
+        let mut touch_points = TouchPoints::default();
+        touch_points.insert(0, 0, Position::new(40., 50.));
+        touch_points.insert(1, 0, Position::new(60., 50.));
+        let mut pinch = Pinch::new(&touch_points).unwrap();
+
+        let (position, size) = (Position::new(0., 0.), Size::new(100., 100.));
+        let bounds = Size::new(100., 200.);
+
+        // Zooming in keeps the pinch center in place.
+        touch_points.insert(0, 1, Position::new(30., 50.));
+        touch_points.insert(1, 1, Position::new(70., 50.));
+        pinch.update(&touch_points);
+        let area = pinch.visible_area(position, size, bounds);
+        assert_eq!(area, (Position::new(25., 25.), Size::new(50., 50.)));
+
+        // Zooming out is not previewed.
+        touch_points.insert(0, 2, Position::new(45., 50.));
+        touch_points.insert(1, 2, Position::new(55., 50.));
+        pinch.update(&touch_points);
+        assert_eq!(pinch.visible_area(position, size, bounds), (position, size));
+
+        // Committed geometry waits for a buffer with the new page scale.
+        pinch.end(1.);
+        assert!(pinch.buffer_updated(1.));
+        assert!(!pinch.buffer_updated(0.5));
+        assert_eq!(pinch.visible_area(position, size, bounds), (position, size));
+
+        // Three touch points are not a pinch.
+        touch_points.insert(2, 3, Position::new(0., 0.));
+        assert!(Pinch::new(&touch_points).is_none());
+    }
+}
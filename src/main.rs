@@ -6,6 +6,7 @@ use std::time::Duration;
 use std::{env, io};
 
 use funq::{MtQueueHandle, Queue, StQueueHandle};
+use gio::FileMonitor;
 use glib::{source, ControlFlow, IOCondition, MainLoop, Priority, Source};
 use glutin::display::{Display, DisplayApiPreference};
 use raw_window_handle::{RawDisplayHandle, WaylandDisplayHandle};
@@ -21,14 +22,25 @@ use smithay_client_toolkit::seat::keyboard::{Keysym, Modifiers, RepeatInfo};
 use tracing::info;
 use tracing_subscriber::{EnvFilter, FmtSubscriber};
 
-use crate::engine::webkit::WebKitError;
+use crate::benchmark::Benchmark;
+use crate::config::{Config, DataSaverConfig};
+use crate::engine::webkit::storage::{self, StorageCleanup};
+use crate::engine::webkit::{self, WebKitError};
 use crate::history::History;
+use crate::session::{Session, SessionHandler, SessionJournal};
 use crate::wayland::protocols::{KeyRepeat, ProtocolStates, TextInput};
 use crate::wayland::WaylandDispatch;
 use crate::window::{KeyboardFocus, Window, WindowId};
 
+mod benchmark;
+mod config;
 mod engine;
 mod history;
+mod input;
+mod memory;
+mod process;
+mod session;
+mod site_policy;
 mod ui;
 mod uri;
 mod wayland;
@@ -61,24 +73,63 @@ fn main() -> Result<(), Error> {
 
     info!("Started Kumo");
 
+    // Isolate benchmark runs from the regular browser profile.
+    let benchmark_profile = match env::args().nth(1).as_deref() {
+        Some("--benchmark") => Some(benchmark::isolate_profile()?),
+        _ => None,
+    };
+
+    // Configure the JavaScript JIT before any threads or web processes exist.
+    let config = Config::load();
+    webkit::configure_jit(config.engine.profile);
+
     let queue = Queue::new()?;
     let main_loop = MainLoop::new(None, true);
-    let mut state = State::new(queue.local_handle(), main_loop.clone())?;
+    // Load the previous session before creating any windows.
+    let session = Session::load();
+
+    let mut state = State::new(queue.local_handle(), main_loop.clone(), config, &session)?;
+
+    // Restore windows from the previous session.
+    let restored = !session.windows.is_empty();
+    let mut window_ids = Vec::with_capacity(session.windows.len());
+    for window_session in session.windows {
+        let window_id = state.create_window()?;
+        state.windows.get_mut(&window_id).unwrap().restore_session(window_session);
+        window_ids.push(window_id);
+    }
 
-    // Create our initial window.
-    let window_id = state.create_window()?;
+    // Create our initial window if no session was restored.
+    let window_id = match window_ids.first() {
+        Some(window_id) => *window_id,
+        None => state.create_window()?,
+    };
 
-    // Spawn a new tab for every CLI argument.
+    // Spawn a new tab for every CLI argument, only loading the first one.
+    let uris = env::args().skip(1).filter(|_| benchmark_profile.is_none());
     let window = state.windows.get_mut(&window_id).unwrap();
-    for (i, arg) in env::args().skip(1).enumerate() {
+    for (i, arg) in uris.enumerate() {
         if i > 0 {
+            window.add_background_tab(&arg);
+            continue;
+        }
+
+        // Keep restored tabs, instead of replacing the active one.
+        if restored {
             window.add_tab(false)?;
-        } else {
-            window.set_keyboard_focus(KeyboardFocus::None);
         }
+
+        window.set_keyboard_focus(KeyboardFocus::None);
         window.load_uri(arg);
     }
 
+    // Compact the restored session, starting a new session journal.
+    state.save_session();
+
+    if let Some(profile_dir) = benchmark_profile {
+        state.start_benchmark(profile_dir)?;
+    }
+
     // Register Wayland socket with GLib event loop.
     let mut queue_handle = queue.handle();
     let wayland_fd = state.connection.as_fd().as_raw_fd();
@@ -118,12 +169,24 @@ pub struct State {
     touch_focus: Option<(WindowId, WlSurface)>,
 
     history: History,
+    config: Config,
+    _config_monitor: Option<FileMonitor>,
+
+    session_journal: SessionJournal,
+    storage_cleanup: StorageCleanup,
+
+    benchmark: Option<Benchmark>,
 
     queue: StQueueHandle<State>,
 }
 
 impl State {
-    fn new(queue: StQueueHandle<Self>, main_loop: MainLoop) -> Result<Self, Error> {
+    fn new(
+        queue: StQueueHandle<Self>,
+        main_loop: MainLoop,
+        config: Config,
+        session: &Session,
+    ) -> Result<Self, Error> {
         // Initialize Wayland connection.
         let connection = Connection::connect_to_env()?;
         let (globals, wayland_queue) = globals::registry_queue_init(&connection)?;
@@ -135,6 +198,18 @@ impl State {
         let raw_display = RawDisplayHandle::Wayland(wayland_display);
         let egl_display = unsafe { Display::new(raw_display, DisplayApiPreference::Egl)? };
 
+        // Reload config on change.
+        let config_monitor = Config::watch(queue.clone());
+
+        // Toggle the data-saver when switching between metered networks.
+        DataSaverConfig::watch_metered(queue.clone());
+
+        // Keep website data within the storage budgets.
+        storage::schedule_cleanup(queue.clone());
+
+        // Release idle pooled engines under memory pressure.
+        window::schedule_engine_pool_trim(queue.clone());
+
         Ok(Self {
             protocol_states,
             egl_display,
@@ -143,6 +218,9 @@ impl State {
             queue,
             wayland_queue: Some(wayland_queue),
             history: History::new(),
+            config,
+            _config_monitor: config_monitor,
+            session_journal: SessionJournal::new(session),
             keyboard_focus: Default::default(),
             touch_focus: Default::default(),
             text_input: Default::default(),
@@ -150,6 +228,8 @@ impl State {
             windows: Default::default(),
             pointer: Default::default(),
             touch: Default::default(),
+            storage_cleanup: Default::default(),
+            benchmark: Default::default(),
         })
     }
 
@@ -164,6 +244,7 @@ impl State {
             self.queue.clone(),
             self.wayland_queue(),
             self.history.clone(),
+            self.config.clone(),
         )?;
         let window_id = window.id();
         self.windows.insert(window_id, window);
@@ -0,0 +1,48 @@
+//! System memory information.
+
+use std::fs;
+
+/// Get the available system memory in MiB.
+///
+/// Returns `None` if the available memory could not be determined.
+pub fn available_mb() -> Option<u64> {
+    let meminfo = fs::read_to_string("/proc/meminfo").ok()?;
+    parse_kb_field(&meminfo, "MemAvailable:").map(|kb| kb / 1024)
+}
+
+/// Get the proportional set size of a process in KiB.
+///
+/// Returns `None` if the process' memory usage could not be determined.
+pub fn process_pss_kb(pid: u32) -> Option<u64> {
+    let smaps = fs::read_to_string(format!("/proc/{pid}/smaps_rollup")).ok()?;
+    parse_kb_field(&smaps, "Pss:")
+}
+
+/// Extract a field in KiB from a `/proc` memory statistics file.
+fn parse_kb_field(stats: &str, field: &str) -> Option<u64> {
+    let line = stats.lines().find(|line| line.starts_with(field))?;
+    let value = line[field.len()..].trim().trim_end_matches("kB").trim();
+    value.parse().ok()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse_meminfo() {
+        let meminfo = "MemTotal:        3884412 kB\nMemFree:          181972 kB\nMemAvailable:    \
+                       1245536 kB\nBuffers:           74224 kB\n";
+        assert_eq!(parse_kb_field(meminfo, "MemAvailable:"), Some(1245536));
+
+        assert_eq!(parse_kb_field("MemTotal:        3884412 kB\n", "MemAvailable:"), None);
+    }
+
+    #[test]
+    fn parse_smaps_rollup() {
+        let smaps = "55d0c4a00000-7ffd3b9f1000 ---p 00000000 00:00 0                      \
+                     [rollup]\nRss:              182340 kB\nPss:                                   \
+                     121873 kB\nPss_Anon:          90112 kB\n";
+        assert_eq!(parse_kb_field(smaps, "Pss:"), Some(121873));
+    }
+}
@@ -0,0 +1,456 @@
+//! Web process scheduling priorities.
+
+use std::fs;
+use std::io::{self, ErrorKind};
+use std::path::{Path, PathBuf};
+
+use smallvec::SmallVec;
+use tracing::{debug, warn};
+
+use crate::engine::EngineId;
+
+/// Web process name, as truncated in `/proc/<pid>/stat`.
+const WEB_PROCESS_NAME: &str = "WPEWebProcess";
+
+/// Root of the cgroup v2 hierarchy.
+const CGROUP_ROOT: &str = "/sys/fs/cgroup";
+
+/// CPU weight of web processes with a visible engine.
+const FOREGROUND_CPU_WEIGHT: u32 = 100;
+
+/// CPU weight of web processes without any visible engine.
+const BACKGROUND_CPU_WEIGHT: u32 = 10;
+
+/// Nice value of background web processes when cgroups are unavailable.
+const BACKGROUND_NICE: i32 = 10;
+
+/// Scheduling priority of a web process.
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+pub enum ProcessPriority {
+    Foreground,
+    Background,
+}
+
+/// Priority tracking for all web processes.
+#[derive(Default)]
+pub struct WebProcesses {
+    control: Option<PriorityControl>,
+    processes: Vec<WebProcess>,
+    /// Processes no longer used by their engines, like suspended pages.
+    retired: Vec<ProcessId>,
+}
+
+impl WebProcesses {
+    /// Register an engine using the web process of `owner`.
+    ///
+    /// This must be called before the engine's web process is spawned.
+    pub fn register(&mut self, owner: EngineId) {
+        // Setup priority control before the first web process is spawned.
+        self.control.get_or_insert_with(PriorityControl::new);
+
+        match self.processes.iter_mut().find(|process| process.owner == owner) {
+            Some(process) => process.engines += 1,
+            None => self.processes.push(WebProcess::new(owner)),
+        }
+    }
+
+    /// Remove an engine using the web process of `owner`.
+    pub fn unregister(&mut self, owner: EngineId, engine: EngineId) {
+        let index = match self.processes.iter().position(|process| process.owner == owner) {
+            Some(index) => index,
+            None => return,
+        };
+
+        let process = &mut self.processes[index];
+        process.visible.retain(|visible| *visible != engine);
+        process.engines -= 1;
+
+        if process.engines == 0 {
+            self.processes.remove(index);
+        } else {
+            self.update(owner);
+        }
+    }
+
+    /// Update an engine's visibility.
+    ///
+    /// Processes are only prioritized while at least one of their engines is
+    /// visible.
+    pub fn set_visible(&mut self, owner: EngineId, engine: EngineId, visible: bool) {
+        let process = match self.processes.iter_mut().find(|process| process.owner == owner) {
+            Some(process) => process,
+            None => return,
+        };
+
+        process.visible.retain(|visible| *visible != engine);
+        if visible {
+            process.visible.push(engine);
+        }
+
+        self.update(owner);
+    }
+
+    /// Forget the PID of a process WebKit has replaced.
+    ///
+    /// This should be called when the web process crashed, or was swapped on
+    /// navigation. The new process is resolved with the next update.
+    pub fn replace(&mut self, owner: EngineId) {
+        let process = match self.processes.iter_mut().find(|process| process.owner == owner) {
+            Some(process) => process,
+            None => return,
+        };
+
+        // Avoid assigning the old process again, if it is kept alive.
+        if let Some(pid) = process.pid.take() {
+            self.retired.push(pid);
+        }
+        process.applied = None;
+    }
+
+    /// Apply the desired priority to a process.
+    ///
+    /// This should be called again once the process has been spawned, in case
+    /// its PID could not be resolved before.
+    pub fn update(&mut self, owner: EngineId) {
+        if matches!(self.control, None | Some(PriorityControl::Disabled)) {
+            return;
+        }
+
+        let index = match self.processes.iter().position(|process| process.owner == owner) {
+            Some(index) => index,
+            None => return,
+        };
+
+        // Resolve the PID again if the process has exited.
+        let process = &mut self.processes[index];
+        if process.pid.map_or(false, |pid| !pid.alive()) {
+            process.pid = None;
+            process.applied = None;
+        }
+
+        let priority = self.processes[index].priority();
+        if self.processes[index].applied == Some(priority) {
+            return;
+        }
+
+        // Resolve PIDs of new web processes.
+        if self.processes[index].pid.is_none() {
+            self.resolve_pids();
+        }
+
+        let control = match &self.control {
+            Some(control) => control,
+            None => return,
+        };
+        let process = &mut self.processes[index];
+        let pid = match process.pid {
+            Some(pid) => pid.pid,
+            None => return,
+        };
+
+        match control.set_priority(pid, priority) {
+            Ok(()) => process.applied = Some(priority),
+            // Resolve the PID again if the process has been replaced.
+            Err(err) if err.kind() == ErrorKind::NotFound => process.pid = None,
+            Err(err) if err.raw_os_error() == Some(libc::ESRCH) => process.pid = None,
+            Err(err) => {
+                warn!("Could not update web process priority: {err}");
+                process.applied = Some(priority);
+            },
+        }
+    }
+
+    /// Assign new web processes to engines waiting for their process.
+    ///
+    /// Since WebKit does not expose the PIDs of its web processes, they are
+    /// assigned in the order they were started. This assumes that WebKit
+    /// spawns processes in the order their engines were registered, which can
+    /// mismatch if a process crashes and is relaunched while others wait for
+    /// their first frame. PIDs cannot be used for ordering, since they wrap.
+    ///
+    /// Only the most recently started unknown processes are assigned, since
+    /// older ones are more likely to be cached or suspended by WebKit.
+    fn resolve_pids(&mut self) {
+        let mut pids = web_process_ids();
+        self.retired.retain(|retired| pids.contains(retired));
+        pids.retain(|pid| {
+            !self.retired.contains(pid)
+                && self.processes.iter().all(|process| process.pid != Some(*pid))
+        });
+
+        let waiting = self.processes.iter().filter(|process| process.pid.is_none()).count();
+        let pids = pids.split_off(pids.len().saturating_sub(waiting));
+
+        let waiting = self.processes.iter_mut().filter(|process| process.pid.is_none());
+        for (process, pid) in waiting.zip(pids) {
+            process.pid = Some(pid);
+            process.applied = None;
+        }
+    }
+}
+
+/// Web process shared by related engines.
+struct WebProcess {
+    visible: SmallVec<[EngineId; 1]>,
+    applied: Option<ProcessPriority>,
+    pid: Option<ProcessId>,
+    owner: EngineId,
+    engines: usize,
+}
+
+impl WebProcess {
+    fn new(owner: EngineId) -> Self {
+        Self { owner, engines: 1, visible: Default::default(), applied: None, pid: None }
+    }
+
+    /// Desired scheduling priority.
+    fn priority(&self) -> ProcessPriority {
+        if self.visible.is_empty() {
+            ProcessPriority::Background
+        } else {
+            ProcessPriority::Foreground
+        }
+    }
+}
+
+/// Process identity, robust against PID reuse.
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+struct ProcessId {
+    pid: u32,
+    /// Time the process started after system boot, in clock ticks.
+    start_time: u64,
+}
+
+impl ProcessId {
+    /// Check if this is still a running web process of the browser.
+    fn alive(&self) -> bool {
+        let stat = match fs::read_to_string(format!("/proc/{}/stat", self.pid)) {
+            Ok(stat) => stat,
+            Err(_) => return false,
+        };
+
+        parse_stat(&stat).map_or(false, |stat| {
+            stat.name == WEB_PROCESS_NAME
+                && stat.parent == std::process::id()
+                && stat.start_time == self.start_time
+        })
+    }
+}
+
+/// Mechanism for changing process priorities.
+enum PriorityControl {
+    /// cgroup v2 groups with different CPU weights.
+    Cgroup { foreground: PathBuf, background: PathBuf },
+    /// Per-thread nice values.
+    Nice,
+    /// Priorities cannot be changed.
+    Disabled,
+}
+
+impl PriorityControl {
+    fn new() -> Self {
+        match Self::new_cgroup() {
+            Ok(control) => return control,
+            Err(err) => debug!("Web process cgroups unavailable: {err}"),
+        }
+
+        // Only lower priorities which can be restored again.
+        if nice_restorable() {
+            Self::Nice
+        } else {
+            debug!("Web process priorities disabled: nice value cannot be restored");
+            Self::Disabled
+        }
+    }
+
+    /// Create cgroups for foreground and background web processes.
+    ///
+    /// This requires write access to the browser's cgroup, which must not
+    /// contain any other processes.
+    fn new_cgroup() -> io::Result<Self> {
+        let cgroup_file = fs::read_to_string("/proc/self/cgroup")?;
+        let cgroup = parse_cgroup(&cgroup_file).ok_or(ErrorKind::Unsupported)?;
+        let cgroup = PathBuf::from(CGROUP_ROOT).join(cgroup.trim_start_matches('/'));
+
+        // Avoid moving processes we do not own.
+        let pid = std::process::id();
+        let procs = fs::read_to_string(cgroup.join("cgroup.procs"))?;
+        if procs.lines().any(|line| line.trim() != pid.to_string()) {
+            return Err(io::Error::other("cgroup is shared with other processes"));
+        }
+
+        // Move browser into a leaf, since only cgroups without processes can
+        // delegate controllers to their children.
+        let browser = create_cgroup(&cgroup, "browser")?;
+        fs::write(browser.join("cgroup.procs"), pid.to_string())?;
+
+        fs::write(cgroup.join("cgroup.subtree_control"), "+cpu")?;
+
+        let foreground = create_cgroup(&cgroup, "foreground")?;
+        fs::write(foreground.join("cpu.weight"), FOREGROUND_CPU_WEIGHT.to_string())?;
+
+        let background = create_cgroup(&cgroup, "background")?;
+        fs::write(background.join("cpu.weight"), BACKGROUND_CPU_WEIGHT.to_string())?;
+
+        Ok(Self::Cgroup { foreground, background })
+    }
+
+    /// Change the priority of a process.
+    fn set_priority(&self, pid: u32, priority: ProcessPriority) -> io::Result<()> {
+        match (self, priority) {
+            (Self::Cgroup { foreground, .. }, ProcessPriority::Foreground) => {
+                fs::write(foreground.join("cgroup.procs"), pid.to_string())
+            },
+            (Self::Cgroup { background, .. }, ProcessPriority::Background) => {
+                fs::write(background.join("cgroup.procs"), pid.to_string())
+            },
+            (Self::Nice, ProcessPriority::Foreground) => set_nice(pid, 0),
+            (Self::Nice, ProcessPriority::Background) => set_nice(pid, BACKGROUND_NICE),
+            (Self::Disabled, _) => Ok(()),
+        }
+    }
+}
+
+/// Create a child cgroup, reusing existing ones.
+fn create_cgroup(parent: &Path, name: &str) -> io::Result<PathBuf> {
+    let path = parent.join(name);
+    match fs::create_dir(&path) {
+        Err(err) if err.kind() != ErrorKind::AlreadyExists => Err(err),
+        _ => Ok(path),
+    }
+}
+
+/// Update the nice value of all threads of a process.
+///
+/// Linux nice values are per-thread, so changing only the PID would leave all
+/// of the web process' worker threads untouched.
+fn set_nice(pid: u32, nice: i32) -> io::Result<()> {
+    for entry in fs::read_dir(format!("/proc/{pid}/task"))? {
+        let tid = match entry?.file_name().to_str().and_then(|tid| tid.parse().ok()) {
+            Some(tid) => tid,
+            None => continue,
+        };
+
+        let result = unsafe { libc::setpriority(libc::PRIO_PROCESS, tid, nice) };
+        if result != 0 {
+            return Err(io::Error::last_os_error());
+        }
+    }
+
+    Ok(())
+}
+
+/// Check if nice values can be lowered back to the default.
+fn nice_restorable() -> bool {
+    if unsafe { libc::geteuid() } == 0 {
+        return true;
+    }
+
+    // The lowest permitted nice value is `20 - RLIMIT_NICE`.
+    let mut limit = libc::rlimit { rlim_cur: 0, rlim_max: 0 };
+    let result = unsafe { libc::getrlimit(libc::RLIMIT_NICE, &mut limit) };
+    result == 0 && limit.rlim_cur >= 20
+}
+
+/// Get the PIDs of all web processes spawned by the browser.
+pub fn web_processes() -> Vec<u32> {
+    web_process_ids().into_iter().map(|process| process.pid).collect()
+}
+
+/// Get the PIDs of all processes spawned by the browser.
+pub fn child_processes() -> Vec<u32> {
+    child_processes_by(|_| true).into_iter().map(|process| process.pid).collect()
+}
+
+/// Get all web processes spawned by the browser.
+fn web_process_ids() -> Vec<ProcessId> {
+    child_processes_by(|name| name == WEB_PROCESS_NAME)
+}
+
+/// Get all processes spawned by the browser with a matching name.
+///
+/// Processes are sorted by start time.
+fn child_processes_by<F: Fn(&str) -> bool>(filter: F) -> Vec<ProcessId> {
+    let browser_pid = std::process::id();
+
+    let entries = match fs::read_dir("/proc") {
+        Ok(entries) => entries,
+        Err(_) => return Vec::new(),
+    };
+
+    let mut processes: Vec<_> = entries
+        .flatten()
+        .filter_map(|entry| {
+            let pid = entry.file_name().to_str()?.parse().ok()?;
+            let stat = fs::read_to_string(entry.path().join("stat")).ok()?;
+            let stat = parse_stat(&stat)?;
+            let start_time = stat.start_time;
+            (stat.parent == browser_pid && filter(stat.name))
+                .then_some(ProcessId { pid, start_time })
+        })
+        .collect();
+    processes.sort_unstable_by_key(|process| (process.start_time, process.pid));
+
+    processes
+}
+
+/// Fields of `/proc/<pid>/stat`.
+#[derive(PartialEq, Eq, Debug)]
+struct ProcStat<'a> {
+    name: &'a str,
+    parent: u32,
+    /// Time the process started after system boot, in clock ticks.
+    start_time: u64,
+}
+
+/// Extract the process name, parent PID, and start time from
+/// `/proc/<pid>/stat`.
+fn parse_stat(stat: &str) -> Option<ProcStat<'_>> {
+    // The name is wrapped in parentheses and might contain any character.
+    let name_start = stat.find('(')? + 1;
+    let name_end = stat.rfind(')')?;
+    let name = stat.get(name_start..name_end)?;
+
+    // Skip the process state to get the parent PID.
+    let mut fields = stat[name_end + 1..].split_whitespace();
+    let parent = fields.nth(1)?.parse().ok()?;
+
+    // Skip to the 22nd field, counting from the PID.
+    let start_time = fields.nth(17)?.parse().ok()?;
+
+    Some(ProcStat { name, parent, start_time })
+}
+
+/// Extract the cgroup v2 path from `/proc/self/cgroup`.
+fn parse_cgroup(cgroup: &str) -> Option<&str> {
+    cgroup.lines().find_map(|line| line.strip_prefix("0::"))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse_proc_stat() {
+        let stat = "4242 (WPEWebProcess) S 4200 4200 3100 34817 4200 4194560 8121 0 0 0 120 30 0 \
+                    0 20 0 12 0 98765 1234567 890";
+        let expected = ProcStat { name: "WPEWebProcess", parent: 4200, start_time: 98765 };
+        assert_eq!(parse_stat(stat), Some(expected));
+
+        let stat = "17 (odd) name)) R 1 17 17 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 42 0 0";
+        let expected = ProcStat { name: "odd) name)", parent: 1, start_time: 42 };
+        assert_eq!(parse_stat(stat), Some(expected));
+
+        assert_eq!(parse_stat("17 (truncated"), None);
+        assert_eq!(parse_stat("17 (short) S 1 17 17 0 -1 4194560"), None);
+    }
+
+    #[test]
+    fn parse_proc_cgroup() {
+        let cgroup = "0::/user.slice/user-1000.slice/app-kumo.scope\n";
+        assert_eq!(parse_cgroup(cgroup), Some("/user.slice/user-1000.slice/app-kumo.scope"));
+
+        let cgroup = "12:cpu,cpuacct:/user.slice\n1:name=systemd:/user.slice\n";
+        assert_eq!(parse_cgroup(cgroup), None);
+    }
+}
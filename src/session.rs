@@ -0,0 +1,641 @@
+//! Browser session persistence.
+//!
+//! The session is stored as a compact snapshot, together with an append-only
+//! journal of all changes since the snapshot was written. Journal writes are
+//! batched to limit flash wear, and the journal is periodically compacted
+//! into a new snapshot.
+
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, ErrorKind, Write};
+use std::path::{Path, PathBuf};
+use std::time::Duration;
+
+use glib::{source, ControlFlow, Priority};
+use tracing::error;
+
+use crate::window::Window;
+use crate::State;
+
+/// Snapshot file format identifier.
+const SNAPSHOT_MAGIC: &[u8; 4] = b"KSES";
+
+/// Journal file format identifier.
+const JOURNAL_MAGIC: &[u8; 4] = b"KJRN";
+
+/// Session file format version.
+const VERSION: u32 = 2;
+
+/// Maximum time journal events are buffered before they are synced to disk.
+const FLUSH_DELAY: Duration = Duration::from_secs(1);
+
+/// Journal size in bytes at which it is compacted into a new snapshot.
+const MAX_JOURNAL_SIZE: u64 = 256 * 1024;
+
+#[funq::callbacks(State)]
+pub trait SessionHandler {
+    /// Record a session change.
+    fn log_session_event(&mut self, event: SessionEvent);
+
+    /// Write buffered session changes to disk.
+    fn flush_session_journal(&mut self);
+
+    /// Replace the session snapshot and clear the journal.
+    fn save_session(&mut self);
+}
+
+impl SessionHandler for State {
+    fn log_session_event(&mut self, event: SessionEvent) {
+        self.session_journal.append(&event);
+
+        // Batch events until the next flush.
+        if self.session_journal.flush_pending {
+            return;
+        }
+        self.session_journal.flush_pending = true;
+
+        let mut queue = self.queue.handle();
+        let source = source::timeout_source_new(FLUSH_DELAY, None, Priority::DEFAULT, move || {
+            queue.flush_session_journal();
+            ControlFlow::Break
+        });
+        source.attach(None);
+    }
+
+    fn flush_session_journal(&mut self) {
+        if let Err(err) = self.session_journal.flush() {
+            error!("Could not write session journal: {err}");
+        }
+
+        if self.session_journal.len >= MAX_JOURNAL_SIZE {
+            self.save_session();
+        }
+    }
+
+    fn save_session(&mut self) {
+        let windows = self.windows.values().map(Window::session).collect();
+        let session = Session { windows, ..Default::default() };
+        if let Err(err) = self.session_journal.compact(session) {
+            error!("Could not save session: {err}");
+        }
+    }
+}
+
+/// Persisted browser session.
+#[derive(PartialEq, Default, Debug)]
+pub struct Session {
+    pub windows: Vec<WindowSession>,
+    /// Snapshot generation, used to match the journal to its snapshot.
+    generation: u64,
+}
+
+impl Session {
+    /// Load the session from its default location.
+    ///
+    /// Returns an empty session if no valid session file exists.
+    pub fn load() -> Self {
+        let (snapshot_path, journal_path) = match session_paths() {
+            Some(paths) => paths,
+            None => return Self::default(),
+        };
+
+        let mut session = match read_file(&snapshot_path).map(|data| Self::decode(&data)) {
+            Some(Some(session)) => session,
+            Some(None) => {
+                error!("Ignoring invalid session {snapshot_path:?}");
+                Self::default()
+            },
+            None => Self::default(),
+        };
+
+        // Apply changes made after the snapshot was written.
+        if let Some(journal) = read_file(&journal_path) {
+            session.replay(&journal);
+        }
+
+        session
+    }
+
+    /// Apply all journal events belonging to this snapshot.
+    ///
+    /// Replay stops at the first incomplete event, which can be caused by a
+    /// power loss during a write.
+    fn replay(&mut self, journal: &[u8]) {
+        let mut reader = Reader { data: journal };
+        if reader.take(JOURNAL_MAGIC.len()) != Some(JOURNAL_MAGIC)
+            || reader.u32() != Some(VERSION)
+            || reader.u64() != Some(self.generation)
+        {
+            return;
+        }
+
+        while let Some(event) = reader.record().and_then(SessionEvent::decode) {
+            self.apply(event);
+        }
+    }
+
+    /// Update the session with a journal event.
+    ///
+    /// Events which are already reflected in the session are ignored.
+    fn apply(&mut self, event: SessionEvent) {
+        match event {
+            SessionEvent::WindowOpened { window } => {
+                if self.window_mut(window).is_none() {
+                    self.windows.push(WindowSession { id: window, ..Default::default() });
+                }
+            },
+            SessionEvent::WindowClosed { window } => self.windows.retain(|w| w.id != window),
+            SessionEvent::TabOpened { window, tab, index } => {
+                let window = match self.window_mut(window) {
+                    Some(window) if window.tab_index(tab).is_none() => window,
+                    _ => return,
+                };
+
+                let index = (index as usize).min(window.tabs.len());
+                window.tabs.insert(index, TabSession { id: tab, ..Default::default() });
+
+                // Keep the active tab pointing at the same tab.
+                if index <= window.active_tab && window.tabs.len() > 1 {
+                    window.active_tab += 1;
+                }
+            },
+            SessionEvent::TabClosed { window, tab } => {
+                let window = match self.window_mut(window) {
+                    Some(window) => window,
+                    None => return,
+                };
+
+                if let Some(index) = window.tab_index(tab) {
+                    window.tabs.remove(index);
+                    if index < window.active_tab {
+                        window.active_tab -= 1;
+                    }
+                }
+            },
+            SessionEvent::TabNavigated { window, tab, uri, state } => {
+                if let Some(tab) = self.tab_mut(window, tab) {
+                    tab.uri = uri;
+                    tab.state = state;
+                }
+            },
+            SessionEvent::TabTitle { window, tab, title } => {
+                if let Some(tab) = self.tab_mut(window, tab) {
+                    tab.title = title;
+                }
+            },
+            SessionEvent::ActiveTab { window, tab } => {
+                let window = match self.window_mut(window) {
+                    Some(window) => window,
+                    None => return,
+                };
+
+                if let Some(index) = window.tab_index(tab) {
+                    window.active_tab = index;
+                }
+            },
+        }
+    }
+
+    /// Get a window by its ID.
+    fn window_mut(&mut self, window: u64) -> Option<&mut WindowSession> {
+        self.windows.iter_mut().find(|w| w.id == window)
+    }
+
+    /// Get a tab by its window and tab ID.
+    fn tab_mut(&mut self, window: u64, tab: u64) -> Option<&mut TabSession> {
+        let window = self.window_mut(window)?;
+        window.tabs.iter_mut().find(|t| t.id == tab)
+    }
+
+    /// Serialize the session.
+    fn encode(&self) -> Vec<u8> {
+        let mut data = Vec::new();
+        data.extend_from_slice(SNAPSHOT_MAGIC);
+        write_u32(&mut data, VERSION);
+        write_u64(&mut data, self.generation);
+
+        write_u32(&mut data, self.windows.len() as u32);
+        for window in &self.windows {
+            write_u64(&mut data, window.id);
+            write_u32(&mut data, window.active_tab as u32);
+            write_u32(&mut data, window.tabs.len() as u32);
+            for tab in &window.tabs {
+                write_u64(&mut data, tab.id);
+                write_bytes(&mut data, tab.uri.as_bytes());
+                write_bytes(&mut data, tab.title.as_bytes());
+                write_bytes(&mut data, &tab.state);
+            }
+        }
+
+        data
+    }
+
+    /// Deserialize a session.
+    fn decode(data: &[u8]) -> Option<Self> {
+        let mut reader = Reader { data };
+        if reader.take(SNAPSHOT_MAGIC.len())? != SNAPSHOT_MAGIC || reader.u32()? != VERSION {
+            return None;
+        }
+
+        let mut session = Self { generation: reader.u64()?, ..Default::default() };
+        for _ in 0..reader.u32()? {
+            let id = reader.u64()?;
+            let active_tab = reader.u32()? as usize;
+            let mut window = WindowSession { id, active_tab, tabs: Vec::new() };
+
+            for _ in 0..reader.u32()? {
+                let id = reader.u64()?;
+                let uri = reader.string()?;
+                let title = reader.string()?;
+                let state = reader.bytes()?.to_vec();
+                window.tabs.push(TabSession { id, uri, title, state });
+            }
+
+            session.windows.push(window);
+        }
+
+        Some(session)
+    }
+}
+
+/// Persisted window state.
+#[derive(PartialEq, Default, Debug)]
+pub struct WindowSession {
+    /// Window ID at the time the session was written.
+    pub id: u64,
+    pub tabs: Vec<TabSession>,
+    pub active_tab: usize,
+}
+
+impl WindowSession {
+    /// Get the index of a tab.
+    fn tab_index(&self, tab: u64) -> Option<usize> {
+        self.tabs.iter().position(|t| t.id == tab)
+    }
+}
+
+/// Persisted tab state.
+#[derive(Clone, PartialEq, Default, Debug)]
+pub struct TabSession {
+    /// Engine ID at the time the session was written.
+    pub id: u64,
+    pub uri: String,
+    pub title: String,
+    /// Serialized engine back-forward history.
+    pub state: Vec<u8>,
+}
+
+/// Change to the browser session.
+#[derive(Clone, PartialEq, Debug)]
+pub enum SessionEvent {
+    WindowOpened { window: u64 },
+    WindowClosed { window: u64 },
+    TabOpened { window: u64, tab: u64, index: u32 },
+    TabClosed { window: u64, tab: u64 },
+    TabNavigated { window: u64, tab: u64, uri: String, state: Vec<u8> },
+    TabTitle { window: u64, tab: u64, title: String },
+    ActiveTab { window: u64, tab: u64 },
+}
+
+impl SessionEvent {
+    /// Serialize the event as a checksummed journal record.
+    fn encode_record(&self, data: &mut Vec<u8>) {
+        let mut payload = Vec::new();
+        self.encode(&mut payload);
+
+        write_bytes(data, &payload);
+        write_u32(data, checksum(&payload));
+    }
+
+    /// Serialize the event.
+    fn encode(&self, data: &mut Vec<u8>) {
+        match self {
+            Self::WindowOpened { window } => {
+                data.push(0);
+                write_u64(data, *window);
+            },
+            Self::WindowClosed { window } => {
+                data.push(1);
+                write_u64(data, *window);
+            },
+            Self::TabOpened { window, tab, index } => {
+                data.push(2);
+                write_u64(data, *window);
+                write_u64(data, *tab);
+                write_u32(data, *index);
+            },
+            Self::TabClosed { window, tab } => {
+                data.push(3);
+                write_u64(data, *window);
+                write_u64(data, *tab);
+            },
+            Self::TabNavigated { window, tab, uri, state } => {
+                data.push(4);
+                write_u64(data, *window);
+                write_u64(data, *tab);
+                write_bytes(data, uri.as_bytes());
+                write_bytes(data, state);
+            },
+            Self::TabTitle { window, tab, title } => {
+                data.push(5);
+                write_u64(data, *window);
+                write_u64(data, *tab);
+                write_bytes(data, title.as_bytes());
+            },
+            Self::ActiveTab { window, tab } => {
+                data.push(6);
+                write_u64(data, *window);
+                write_u64(data, *tab);
+            },
+        }
+    }
+
+    /// Deserialize an event.
+    fn decode(data: &[u8]) -> Option<Self> {
+        let mut reader = Reader { data };
+        let event = match reader.take(1)?[0] {
+            0 => Self::WindowOpened { window: reader.u64()? },
+            1 => Self::WindowClosed { window: reader.u64()? },
+            2 => {
+                Self::TabOpened { window: reader.u64()?, tab: reader.u64()?, index: reader.u32()? }
+            },
+            3 => Self::TabClosed { window: reader.u64()?, tab: reader.u64()? },
+            4 => Self::TabNavigated {
+                window: reader.u64()?,
+                tab: reader.u64()?,
+                uri: reader.string()?,
+                state: reader.bytes()?.to_vec(),
+            },
+            5 => Self::TabTitle {
+                window: reader.u64()?,
+                tab: reader.u64()?,
+                title: reader.string()?,
+            },
+            6 => Self::ActiveTab { window: reader.u64()?, tab: reader.u64()? },
+            _ => return None,
+        };
+        Some(event)
+    }
+}
+
+/// Append-only session change log.
+#[derive(Default)]
+pub struct SessionJournal {
+    file: Option<File>,
+    /// Encoded events awaiting the next flush.
+    pending: Vec<u8>,
+    flush_pending: bool,
+    /// Journal size on disk.
+    len: u64,
+    generation: u64,
+}
+
+impl SessionJournal {
+    /// Open the journal for the loaded session.
+    ///
+    /// The journal is only appended to after the next compaction, so stale
+    /// events are never mixed with the current session.
+    pub fn new(session: &Session) -> Self {
+        Self { generation: session.generation, ..Default::default() }
+    }
+
+    /// Buffer an event for the next flush.
+    fn append(&mut self, event: &SessionEvent) {
+        // Ignore changes before the first compaction.
+        if self.file.is_none() {
+            return;
+        }
+
+        event.encode_record(&mut self.pending);
+    }
+
+    /// Write and sync all buffered events.
+    fn flush(&mut self) -> io::Result<()> {
+        self.flush_pending = false;
+
+        let file = match &mut self.file {
+            Some(file) if !self.pending.is_empty() => file,
+            _ => return Ok(()),
+        };
+
+        file.write_all(&self.pending)?;
+        file.sync_data()?;
+
+        self.len += self.pending.len() as u64;
+        self.pending.clear();
+
+        Ok(())
+    }
+
+    /// Replace the snapshot with the current session and clear the journal.
+    fn compact(&mut self, mut session: Session) -> io::Result<()> {
+        let (snapshot_path, journal_path) = match session_paths() {
+            Some(paths) => paths,
+            None => return Ok(()),
+        };
+
+        // The snapshot includes all buffered changes.
+        self.pending.clear();
+
+        self.generation += 1;
+        session.generation = self.generation;
+
+        if let Some(dir) = snapshot_path.parent() {
+            fs::create_dir_all(dir)?;
+        }
+
+        // Replace the snapshot atomically, to avoid truncated sessions.
+        let tmp_path = snapshot_path.with_extension("tmp");
+        let mut tmp_file = File::create(&tmp_path)?;
+        tmp_file.write_all(&session.encode())?;
+        tmp_file.sync_all()?;
+        fs::rename(tmp_path, &snapshot_path)?;
+
+        // Persist the rename before truncating the journal, otherwise a crash
+        // could leave the old snapshot with an empty journal.
+        if let Some(dir) = snapshot_path.parent() {
+            File::open(dir)?.sync_all()?;
+        }
+
+        // Start a new journal for the new snapshot.
+        //
+        // A stale journal is ignored on load, since its generation will not
+        // match the snapshot.
+        let mut header = Vec::new();
+        header.extend_from_slice(JOURNAL_MAGIC);
+        write_u32(&mut header, VERSION);
+        write_u64(&mut header, self.generation);
+
+        let mut file = OpenOptions::new().create(true).append(true).open(journal_path)?;
+        file.set_len(0)?;
+        file.write_all(&header)?;
+        file.sync_all()?;
+
+        self.len = header.len() as u64;
+        self.file = Some(file);
+
+        Ok(())
+    }
+}
+
+/// Session deserialization helper.
+struct Reader<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> Reader<'a> {
+    /// Read a fixed number of bytes.
+    fn take(&mut self, len: usize) -> Option<&'a [u8]> {
+        if self.data.len() < len {
+            return None;
+        }
+
+        let (bytes, data) = self.data.split_at(len);
+        self.data = data;
+        Some(bytes)
+    }
+
+    /// Read a little-endian u32.
+    fn u32(&mut self) -> Option<u32> {
+        let bytes = self.take(4)?;
+        Some(u32::from_le_bytes(bytes.try_into().ok()?))
+    }
+
+    /// Read a little-endian u64.
+    fn u64(&mut self) -> Option<u64> {
+        let bytes = self.take(8)?;
+        Some(u64::from_le_bytes(bytes.try_into().ok()?))
+    }
+
+    /// Read length-prefixed bytes.
+    fn bytes(&mut self) -> Option<&'a [u8]> {
+        let len = self.u32()? as usize;
+        self.take(len)
+    }
+
+    /// Read a length-prefixed UTF-8 string.
+    fn string(&mut self) -> Option<String> {
+        let bytes = self.bytes()?;
+        String::from_utf8(bytes.to_vec()).ok()
+    }
+
+    /// Read a journal record's payload, verifying its checksum.
+    fn record(&mut self) -> Option<&'a [u8]> {
+        let payload = self.bytes()?;
+        (self.u32()? == checksum(payload)).then_some(payload)
+    }
+}
+
+/// Write a little-endian u32.
+fn write_u32(data: &mut Vec<u8>, value: u32) {
+    data.extend_from_slice(&value.to_le_bytes());
+}
+
+/// Write a little-endian u64.
+fn write_u64(data: &mut Vec<u8>, value: u64) {
+    data.extend_from_slice(&value.to_le_bytes());
+}
+
+/// Write length-prefixed bytes.
+fn write_bytes(data: &mut Vec<u8>, bytes: &[u8]) {
+    write_u32(data, bytes.len() as u32);
+    data.extend_from_slice(bytes);
+}
+
+/// FNV-1a checksum for detecting torn journal writes.
+fn checksum(data: &[u8]) -> u32 {
+    data.iter().fold(0x811C9DC5, |hash, byte| (hash ^ *byte as u32).wrapping_mul(0x01000193))
+}
+
+/// Read a file, logging all errors except for missing files.
+fn read_file(path: &Path) -> Option<Vec<u8>> {
+    match fs::read(path) {
+        Ok(data) => Some(data),
+        Err(err) if err.kind() == ErrorKind::NotFound => None,
+        Err(err) => {
+            error!("Could not read session {path:?}: {err}");
+            None
+        },
+    }
+}
+
+/// Get the session snapshot and journal paths.
+fn session_paths() -> Option<(PathBuf, PathBuf)> {
+    let dir = dirs::data_dir()?.join("kumo/default");
+    Some((dir.join("session.bin"), dir.join("session.journal")))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn tab(id: u64, uri: &str) -> TabSession {
+        TabSession { id, uri: uri.into(), title: "Title".into(), state: vec![1, 2, 3] }
+    }
+
+    #[test]
+    fn session_roundtrip() {
+        let session = Session {
+            windows: vec![
+                WindowSession {
+                    id: 3,
+                    tabs: vec![tab(1, "https://example.org"), tab(2, "https://example.com")],
+                    active_tab: 1,
+                },
+                WindowSession::default(),
+            ],
+            generation: 7,
+        };
+
+        let data = session.encode();
+        assert_eq!(Session::decode(&data), Some(session));
+
+        // Truncated sessions are rejected.
+        assert_eq!(Session::decode(&data[..data.len() - 1]), None);
+        assert_eq!(Session::decode(b"KSES"), None);
+    }
+
+    #[test]
+    fn journal_replay() {
+        let mut session = Session {
+            windows: vec![WindowSession { id: 0, tabs: vec![tab(1, "a")], active_tab: 0 }],
+            generation: 2,
+        };
+
+        let events = [
+            SessionEvent::TabOpened { window: 0, tab: 5, index: 1 },
+            SessionEvent::TabNavigated { window: 0, tab: 5, uri: "b".into(), state: vec![9] },
+            SessionEvent::TabTitle { window: 0, tab: 5, title: "B".into() },
+            SessionEvent::ActiveTab { window: 0, tab: 5 },
+            SessionEvent::TabOpened { window: 0, tab: 6, index: 0 },
+            SessionEvent::TabClosed { window: 0, tab: 1 },
+            SessionEvent::WindowOpened { window: 9 },
+        ];
+
+        let mut data = Vec::new();
+        data.extend_from_slice(JOURNAL_MAGIC);
+        write_u32(&mut data, VERSION);
+        write_u64(&mut data, 2);
+        for event in &events {
+            event.encode_record(&mut data);
+        }
+
+        // Torn writes at the end of the journal are ignored.
+        data.extend_from_slice(&[42, 0, 0]);
+
+        session.replay(&data);
+
+        let window = &session.windows[0];
+        let tabs: Vec<_> = window.tabs.iter().map(|tab| tab.id).collect();
+        assert_eq!(tabs, vec![6, 5]);
+        assert_eq!(window.active_tab, 1);
+        assert_eq!(window.tabs[1].uri, "b");
+        assert_eq!(window.tabs[1].title, "B");
+        assert_eq!(window.tabs[1].state, vec![9]);
+        assert_eq!(session.windows.len(), 2);
+
+        // Journals of other snapshots are ignored.
+        let mut other = Session { generation: 3, ..Default::default() };
+        other.replay(&data);
+        assert_eq!(other, Session { generation: 3, ..Default::default() });
+    }
+}
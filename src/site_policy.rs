@@ -0,0 +1,134 @@
+//! Per-site feature policies.
+
+use std::collections::HashMap;
+use std::fs;
+use std::path::Path;
+
+use glib::{Uri, UriFlags};
+use rusqlite::Connection as SqliteConnection;
+use tracing::error;
+
+/// Features which can be disabled for individual sites.
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+pub struct SitePolicy {
+    /// Allow JavaScript execution.
+    pub javascript: bool,
+    /// Allow media playback without user interaction.
+    pub autoplay: bool,
+    /// Allow WebGL.
+    pub webgl: bool,
+}
+
+impl Default for SitePolicy {
+    fn default() -> Self {
+        Self { javascript: true, autoplay: true, webgl: true }
+    }
+}
+
+/// Site policies by domain.
+///
+/// Policies are loaded from the `site_policies` table of the profile database
+/// once, so lookups never have to wait for the disk.
+#[derive(Default)]
+pub struct SitePolicies {
+    policies: HashMap<String, SitePolicy>,
+}
+
+impl SitePolicies {
+    /// Load all policies from the profile database.
+    pub fn load() -> Self {
+        // Get storage path, ignoring persistence if it can't be retrieved.
+        let path = match dirs::data_dir() {
+            Some(data_dir) => data_dir.join("kumo/default/history.sqlite"),
+            None => return Self::default(),
+        };
+
+        match load_policies(&path) {
+            Ok(policies) => Self { policies },
+            Err(err) => {
+                error!("Could not load site policies: {err}");
+                Self::default()
+            },
+        }
+    }
+
+    /// Get the policy for a URI.
+    ///
+    /// Policies of a domain also apply to all of its subdomains.
+    pub fn get(&self, uri: &str) -> SitePolicy {
+        if self.policies.is_empty() {
+            return SitePolicy::default();
+        }
+
+        match Uri::parse(uri, UriFlags::NONE).ok().and_then(|uri| uri.host()) {
+            Some(host) => self.domain_policy(&host.to_ascii_lowercase()),
+            None => SitePolicy::default(),
+        }
+    }
+
+    /// Get the policy of the closest matching domain.
+    fn domain_policy(&self, mut domain: &str) -> SitePolicy {
+        loop {
+            if let Some(policy) = self.policies.get(domain) {
+                return *policy;
+            }
+
+            match domain.split_once('.') {
+                Some((_, parent)) => domain = parent,
+                None => return SitePolicy::default(),
+            }
+        }
+    }
+}
+
+/// Load policies from the database.
+fn load_policies(path: &Path) -> rusqlite::Result<HashMap<String, SitePolicy>> {
+    // Ensure necessary directories exist.
+    if let Some(dir) = path.parent() {
+        let _ = fs::create_dir_all(dir);
+    }
+
+    let connection = SqliteConnection::open(path)?;
+
+    // Setup table if it doesn't exist yet.
+    connection.execute(
+        "CREATE TABLE IF NOT EXISTS site_policies (
+            domain TEXT NOT NULL PRIMARY KEY,
+            javascript INTEGER NOT NULL DEFAULT 1,
+            autoplay INTEGER NOT NULL DEFAULT 1,
+            webgl INTEGER NOT NULL DEFAULT 1
+        )",
+        [],
+    )?;
+
+    let mut statement =
+        connection.prepare("SELECT domain, javascript, autoplay, webgl FROM site_policies")?;
+    let policies = statement
+        .query_map([], |row| {
+            let domain: String = row.get(0)?;
+            let policy =
+                SitePolicy { javascript: row.get(1)?, autoplay: row.get(2)?, webgl: row.get(3)? };
+            Ok((domain.to_ascii_lowercase(), policy))
+        })?
+        .flatten()
+        .collect();
+    Ok(policies)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn subdomain_policy() {
+        let no_js = SitePolicy { javascript: false, ..SitePolicy::default() };
+        let mut policies = SitePolicies::default();
+        policies.policies.insert("example.org".into(), no_js);
+
+        assert_eq!(policies.domain_policy("example.org"), no_js);
+        assert_eq!(policies.domain_policy("www.example.org"), no_js);
+        assert_eq!(policies.domain_policy("a.b.example.org"), no_js);
+        assert_eq!(policies.domain_policy("notexample.org"), SitePolicy::default());
+        assert_eq!(policies.domain_policy("example.com"), SitePolicy::default());
+    }
+}
@@ -1,14 +1,20 @@
 //! Tabs overlay.
 
+use std::collections::hash_map::Entry;
 use std::collections::HashMap;
+use std::ffi::c_void;
 use std::mem;
+use std::time::{Duration, Instant};
 
 use funq::MtQueueHandle;
+use pangocairo::pango::Alignment;
 use smithay_client_toolkit::seat::keyboard::Modifiers;
 
 use crate::engine::{Engine, EngineId};
 use crate::ui::overlay::Popup;
-use crate::ui::renderer::{Renderer, TextLayout, TextOptions, Texture, TextureBuilder};
+use crate::ui::renderer::{
+    RenderTexture, Renderer, TextLayout, TextOptions, Texture, TextureBuilder,
+};
 use crate::{gl, rect_contains, Position, Size, State, WindowId};
 
 /// Tab text color of active tab.
@@ -19,6 +25,8 @@ const INACTIVE_TAB_FG: [f64; 3] = [0.8, 0.8, 0.8];
 const TABS_BG: [f64; 3] = [0.09, 0.09, 0.09];
 /// New tab button background color.
 const NEW_TAB_BG: [f64; 3] = [0.15, 0.15, 0.15];
+/// Data-saver button background color while enabled.
+const DATA_SAVER_ACTIVE_BG: [f64; 3] = [0.25, 0.35, 0.25];
 
 /// Tab font size.
 const FONT_SIZE: u8 = 20;
@@ -41,12 +49,21 @@ const CLOSE_PADDING: f64 = 30.;
 /// Logical height of each tab.
 const TAB_HEIGHT: u32 = 50;
 
+/// Logical width of each tab's thumbnail.
+const THUMBNAIL_WIDTH: u32 = 75;
+
+/// Minimum interval between thumbnail refreshes of a tab.
+const THUMBNAIL_INTERVAL: Duration = Duration::from_secs(1);
+
 /// Logical height of the "New Tab" button.
 const NEW_TAB_BUTTON_HEIGHT: u32 = 60;
 
 /// Size of the "New Tab" button `+` icon.
 const NEW_TAB_ICON_SIZE: f64 = 30.;
 
+/// Logical width of the data-saver button, including padding.
+const DATA_SAVER_BUTTON_WIDTH: u32 = 140;
+
 /// Square of the maximum distance before touch input is considered a drag.
 const MAX_TAP_DISTANCE: f64 = 400.;
 
@@ -60,6 +77,9 @@ trait TabsHandler {
 
     /// Close a tab.
     fn close_tab(&mut self, engine_id: EngineId);
+
+    /// Toggle the data-saver of a window.
+    fn toggle_data_saver(&mut self, window: WindowId);
 }
 
 impl TabsHandler for State {
@@ -89,11 +109,22 @@ impl TabsHandler for State {
 
         window.close_tab(engine_id);
     }
+
+    fn toggle_data_saver(&mut self, window_id: WindowId) {
+        let window = match self.windows.get_mut(&window_id) {
+            Some(window) => window,
+            None => return,
+        };
+
+        window.toggle_data_saver();
+    }
 }
 
 /// Tab overview UI.
 pub struct Tabs {
     texture_cache: TextureCache,
+    thumbnails: ThumbnailPool,
+    thumbnail_images: Vec<(EngineId, *mut c_void, Size)>,
     scroll_offset: f64,
 
     size: Size,
@@ -103,6 +134,7 @@ pub struct Tabs {
     window_id: WindowId,
 
     new_tab_button: NewTabButton,
+    data_saver_button: DataSaverButton,
 
     touch_state: TouchState,
 
@@ -117,7 +149,10 @@ impl Tabs {
             queue,
             scale: 1.0,
             new_tab_button: Default::default(),
+            data_saver_button: Default::default(),
             texture_cache: Default::default(),
+            thumbnail_images: Default::default(),
+            thumbnails: Default::default(),
             scroll_offset: Default::default(),
             touch_state: Default::default(),
             visible: Default::default(),
@@ -132,15 +167,39 @@ impl Tabs {
         T: Iterator<Item = &'a Box<dyn Engine>>,
     {
         self.texture_cache.set_tabs(tabs, active_tab);
+        self.thumbnails.retain(&self.texture_cache.tabs);
         self.dirty = true;
     }
 
+    /// Update the engine frames used for refreshing tab thumbnails.
+    ///
+    /// Since the images are owned by their engines, they are only used for the
+    /// next draw.
+    pub fn set_thumbnail_images<'a, T>(&mut self, tabs: T)
+    where
+        T: Iterator<Item = &'a Box<dyn Engine>>,
+    {
+        self.thumbnail_images.clear();
+        let images =
+            tabs.filter_map(|tab| tab.egl_image().map(|(image, size)| (tab.id(), image, size)));
+        self.thumbnail_images.extend(images);
+    }
+
     /// Update the active tab for this cache.
     pub fn set_active_tab(&mut self, active_tab: EngineId) {
         self.texture_cache.set_active_tab(active_tab);
         self.dirty = true;
     }
 
+    /// Update the data-saver button state.
+    pub fn set_data_saver(&mut self, enabled: bool) {
+        if self.data_saver_button.enabled != enabled {
+            self.data_saver_button.enabled = enabled;
+            self.data_saver_button.dirty = true;
+            self.dirty = true;
+        }
+    }
+
     /// Check whether the popup is active.
     pub fn visible(&self) -> bool {
         self.visible
@@ -157,7 +216,25 @@ impl Tabs {
     /// This includes all padding since that is included in the texture.
     fn new_tab_button_size(&self) -> Size {
         let height = NEW_TAB_BUTTON_HEIGHT + (2. * NEW_TAB_Y_PADDING).round() as u32;
-        Size::new(self.size.width, height) * self.scale
+        let width = self.size.width.saturating_sub(DATA_SAVER_BUTTON_WIDTH);
+        Size::new(width, height) * self.scale
+    }
+
+    /// Physical size of the data-saver button.
+    ///
+    /// This includes all padding since that is included in the texture.
+    fn data_saver_button_size(&self) -> Size {
+        let height = NEW_TAB_BUTTON_HEIGHT + (2. * NEW_TAB_Y_PADDING).round() as u32;
+        let width = DATA_SAVER_BUTTON_WIDTH.min(self.size.width);
+        Size::new(width, height) * self.scale
+    }
+
+    /// Physical position of the data-saver button, right of the "New Tab"
+    /// button.
+    fn data_saver_button_position(&self) -> Position<f64> {
+        let mut position = self.new_tab_button_position();
+        position.x += self.new_tab_button_size().width as f64;
+        position
     }
 
     /// Physical position of the "New Tab" button.
@@ -174,6 +251,12 @@ impl Tabs {
         Size::new(width, TAB_HEIGHT) * self.scale
     }
 
+    /// Get physical size of the tab thumbnails.
+    fn thumbnail_size(tab_size: Size, scale: f64) -> Size {
+        let width = (THUMBNAIL_WIDTH as f64 * scale).round() as u32;
+        Size::new(width, tab_size.height)
+    }
+
     /// Get physical size of the close button.
     fn close_button_size(tab_size: Size, scale: f64) -> Size<f64> {
         let size = tab_size.height as f64 - CLOSE_PADDING * scale;
@@ -273,6 +356,9 @@ impl Popup for Tabs {
     fn draw(&mut self, renderer: &Renderer) {
         self.dirty = false;
 
+        // Release engine images, which are only valid for this draw.
+        let mut thumbnail_images = mem::take(&mut self.thumbnail_images);
+
         // Don't render anything when hidden.
         if !self.visible {
             return;
@@ -284,6 +370,30 @@ impl Popup for Tabs {
         // Get geometry required for rendering.
         let new_tab_button_position: Position<f32> = self.new_tab_button_position().into();
         let tab_size = self.tab_size();
+        let tab_height = tab_size.height as f32;
+        let tab_padding = (TABS_Y_PADDING * self.scale) as f32;
+        let tab_visible = |y: f32| y < new_tab_button_position.y && y > -tab_height;
+
+        // Refresh thumbnails of tabs within the viewport.
+        //
+        // This is done before any other rendering, to avoid switching between
+        // framebuffers in the middle of the frame.
+        self.thumbnails.set_size(Self::thumbnail_size(tab_size, self.scale));
+        let mut tab_y = new_tab_button_position.y + self.scroll_offset as f32;
+        for tab in self.texture_cache.tabs.iter().rev() {
+            tab_y -= tab_height;
+            if tab_visible(tab_y) {
+                let image = thumbnail_images.iter().find(|(engine, ..)| *engine == tab.engine);
+                if let Some(&(engine, image, image_size)) = image {
+                    self.thumbnails.update(renderer, engine, image, image_size);
+                }
+            }
+            tab_y -= tab_padding;
+        }
+
+        // Keep the image buffer's allocation for the next frame.
+        thumbnail_images.clear();
+        self.thumbnail_images = thumbnail_images;
 
         // Render the tabs UI.
         // Get textures for all tabs.
@@ -292,8 +402,10 @@ impl Popup for Tabs {
         // associated with the correct program.
         let tab_textures = self.texture_cache.textures(tab_size, self.scale);
 
-        // Get "New Tab" button texture.
+        // Get "New Tab" and data-saver button textures.
         let new_tab_button = self.new_tab_button.texture();
+        let data_saver_button = self.data_saver_button.texture();
+        let data_saver_button_position: Position<f32> = self.data_saver_button_position().into();
 
         // Draw background.
         //
@@ -309,22 +421,26 @@ impl Popup for Tabs {
         let mut texture_pos = new_tab_button_position;
         texture_pos.x += (TABS_X_PADDING * self.scale) as f32;
         texture_pos.y += self.scroll_offset as f32;
-        for texture in tab_textures {
+        for (engine, texture) in tab_textures {
             // Render only tabs within the viewport.
             texture_pos.y -= texture.height as f32;
-            if texture_pos.y < new_tab_button_position.y
-                && texture_pos.y > -1. * texture.height as f32
-            {
+            if tab_visible(texture_pos.y) {
                 unsafe { renderer.draw_texture_at(texture, texture_pos, None) };
+
+                // Draw thumbnail over the tab's left edge.
+                if let Some(thumbnail) = self.thumbnails.get(engine) {
+                    unsafe { renderer.draw_texture_at(thumbnail, texture_pos, None) };
+                }
             }
 
             // Add padding after the tab.
-            texture_pos.y -= (TABS_Y_PADDING * self.scale) as f32
+            texture_pos.y -= tab_padding;
         }
 
         // Draw "New Tab" button, last, to render over scrolled tabs.
         texture_pos = new_tab_button_position;
         unsafe { renderer.draw_texture_at(new_tab_button, texture_pos, None) };
+        unsafe { renderer.draw_texture_at(data_saver_button, data_saver_button_position, None) };
     }
 
     fn position(&self) -> Position {
@@ -337,6 +453,7 @@ impl Popup for Tabs {
 
         // Update UI element sizes.
         self.new_tab_button.set_geometry(self.new_tab_button_size(), self.scale);
+        self.data_saver_button.set_geometry(self.data_saver_button_size(), self.scale);
         self.texture_cache.clear_textures();
     }
 
@@ -350,6 +467,7 @@ impl Popup for Tabs {
 
         // Update UI element scales.
         self.new_tab_button.set_geometry(self.new_tab_button_size(), self.scale);
+        self.data_saver_button.set_geometry(self.data_saver_button_size(), self.scale);
         self.texture_cache.clear_textures();
     }
 
@@ -373,8 +491,14 @@ impl Popup for Tabs {
         let new_tab_button_position = self.new_tab_button_position();
         let new_tab_button_size = self.new_tab_button_size().into();
 
+        // Get data-saver button geometry.
+        let data_saver_button_position = self.data_saver_button_position();
+        let data_saver_button_size = self.data_saver_button_size().into();
+
         if rect_contains(new_tab_button_position, new_tab_button_size, position) {
             self.touch_state.action = TouchAction::NewTabTap;
+        } else if rect_contains(data_saver_button_position, data_saver_button_size, position) {
+            self.touch_state.action = TouchAction::DataSaverTap;
         } else {
             self.touch_state.action = TouchAction::TabTap;
         }
@@ -396,8 +520,8 @@ impl Popup for Tabs {
         let position = position * self.scale;
         let old_position = mem::replace(&mut self.touch_state.position, position);
 
-        // Ignore drag when tap started on "New Tab" button.
-        if self.touch_state.action == TouchAction::NewTabTap {
+        // Ignore drag when tap started on the "New Tab" or data-saver buttons.
+        if matches!(self.touch_state.action, TouchAction::NewTabTap | TouchAction::DataSaverTap) {
             return;
         }
 
@@ -433,6 +557,16 @@ impl Popup for Tabs {
                     self.queue.add_tab(self.window_id);
                 }
             },
+            // Toggle the window's data-saver.
+            TouchAction::DataSaverTap => {
+                let data_saver_button_position = self.data_saver_button_position();
+                let data_saver_button_size = self.data_saver_button_size().into();
+                let position = self.touch_state.position;
+
+                if rect_contains(data_saver_button_position, data_saver_button_size, position) {
+                    self.queue.toggle_data_saver(self.window_id);
+                }
+            },
             // Switch tabs for tap actions on a tab.
             TouchAction::TabTap => {
                 if let Some((&RenderTab { engine, .. }, close)) =
@@ -484,7 +618,11 @@ impl TextureCache {
     ///
     /// This will automatically maintain an internal cache to avoid re-drawing
     /// textures for tabs that have not changed.
-    fn textures(&mut self, tab_size: Size, scale: f64) -> impl Iterator<Item = &Texture> {
+    fn textures(
+        &mut self,
+        tab_size: Size,
+        scale: f64,
+    ) -> impl Iterator<Item = (EngineId, &Texture)> {
         // Remove unused URIs from cache.
         self.textures.retain(|uri, texture| {
             let retain = self.tabs.iter().any(|tab| &tab.uri == uri);
@@ -524,9 +662,11 @@ impl TextureCache {
 
             // Calculate available area font font rendering.
             let close_position = Tabs::close_button_position(tab_size, scale);
-            let text_width = (close_position.x - close_position.y).round() as i32;
+            let thumbnail_width = Tabs::thumbnail_size(tab_size, scale).width as f64;
+            let text_x = thumbnail_width + close_position.y;
+            let text_width = (close_position.x - text_x).round() as i32;
             let text_size = Size::new(text_width, tab_size.height as i32);
-            text_options.position(Position::new(close_position.y, 0.));
+            text_options.position(Position::new(text_x, 0.));
             text_options.size(text_size);
 
             // Render text to the texture.
@@ -549,10 +689,97 @@ impl TextureCache {
         }
 
         // Get textures for all tabs in reverse order.
-        self.tabs.iter().rev().map(|tab| self.textures.get(&tab.uri).unwrap())
+        self.tabs.iter().rev().map(|tab| (tab.engine, self.textures.get(&tab.uri).unwrap()))
     }
 }
 
+/// Pool of GPU-rendered tab thumbnails.
+#[derive(Default)]
+struct ThumbnailPool {
+    thumbnails: HashMap<EngineId, Thumbnail>,
+    free: Vec<RenderTexture>,
+    size: Size,
+}
+
+impl ThumbnailPool {
+    /// Update the physical thumbnail size.
+    ///
+    /// This must be called with the renderer bound, since textures of the
+    /// previous size are deleted.
+    fn set_size(&mut self, size: Size) {
+        if self.size == size {
+            return;
+        }
+        self.size = size;
+
+        let thumbnails = self.thumbnails.drain().map(|(_, thumbnail)| thumbnail.texture);
+        for texture in thumbnails.chain(self.free.drain(..)) {
+            texture.delete();
+        }
+    }
+
+    /// Return thumbnails of closed tabs to the pool.
+    fn retain(&mut self, tabs: &[RenderTab]) {
+        let closed: Vec<_> = self
+            .thumbnails
+            .keys()
+            .filter(|engine| tabs.iter().all(|tab| tab.engine != **engine))
+            .copied()
+            .collect();
+
+        for engine in closed {
+            if let Some(thumbnail) = self.thumbnails.remove(&engine) {
+                self.free.push(thumbnail.texture);
+            }
+        }
+    }
+
+    /// Get an engine's thumbnail.
+    fn get(&self, engine: EngineId) -> Option<&Texture> {
+        self.thumbnails.get(&engine).map(|thumbnail| &thumbnail.texture.texture)
+    }
+
+    /// Refresh an engine's thumbnail from its EGLImage.
+    ///
+    /// The image is downscaled on the GPU, avoiding any pixel readback.
+    /// Thumbnails are refreshed at most once every [`THUMBNAIL_INTERVAL`].
+    fn update(&mut self, renderer: &Renderer, engine: EngineId, image: *mut c_void, size: Size) {
+        let outdated = self
+            .thumbnails
+            .get(&engine)
+            .map_or(true, |thumbnail| thumbnail.updated.elapsed() >= THUMBNAIL_INTERVAL);
+        if !outdated || size.width == 0 || size.height == 0 {
+            return;
+        }
+
+        let (width, height) = (size.width as usize, size.height as usize);
+        let source = match unsafe { Texture::from_egl_image(image, width, height) } {
+            Some(source) => source,
+            None => return,
+        };
+
+        let thumbnail = match self.thumbnails.entry(engine) {
+            Entry::Occupied(entry) => entry.into_mut(),
+            Entry::Vacant(entry) => {
+                let (width, height) = (self.size.width as usize, self.size.height as usize);
+                let texture = self.free.pop().unwrap_or_else(|| RenderTexture::new(width, height));
+                entry.insert(Thumbnail { texture, updated: Instant::now() })
+            },
+        };
+
+        unsafe { renderer.draw_texture_to(&thumbnail.texture, &source, NEW_TAB_BG) };
+        thumbnail.updated = Instant::now();
+
+        source.delete();
+    }
+}
+
+/// Downscaled engine frame.
+struct Thumbnail {
+    texture: RenderTexture,
+    updated: Instant,
+}
+
 /// Information required to render a tab.
 #[derive(Debug)]
 struct RenderTab {
@@ -650,6 +877,84 @@ impl NewTabButton {
     }
 }
 
+/// Per-window data-saver toggle.
+struct DataSaverButton {
+    texture: Option<Texture>,
+    enabled: bool,
+    dirty: bool,
+    size: Size,
+    scale: f64,
+}
+
+impl Default for DataSaverButton {
+    fn default() -> Self {
+        Self {
+            dirty: true,
+            scale: 1.,
+            texture: Default::default(),
+            enabled: Default::default(),
+            size: Default::default(),
+        }
+    }
+}
+
+impl DataSaverButton {
+    fn texture(&mut self) -> &Texture {
+        // Ensure texture is up to date.
+        if mem::take(&mut self.dirty) {
+            if let Some(texture) = self.texture.take() {
+                texture.delete();
+            }
+            self.texture = Some(self.draw());
+        }
+
+        self.texture.as_ref().unwrap()
+    }
+
+    /// Draw the button into an OpenGL texture.
+    fn draw(&self) -> Texture {
+        // Clear with background color.
+        let builder = TextureBuilder::new(self.size.into());
+        builder.clear(TABS_BG);
+
+        // Draw button background, highlighted while enabled.
+        let x_padding = NEW_TAB_X_PADDING * self.scale;
+        let y_padding = NEW_TAB_Y_PADDING * self.scale;
+        let width = self.size.width as f64 - 2. * x_padding;
+        let height = self.size.height as f64 - 2. * y_padding;
+        let [r, g, b] = if self.enabled { DATA_SAVER_ACTIVE_BG } else { NEW_TAB_BG };
+        builder.context().rectangle(x_padding, y_padding, width.round(), height.round());
+        builder.context().set_source_rgb(r, g, b);
+        builder.context().fill().unwrap();
+
+        // Draw button label.
+        let layout = TextLayout::new(FONT_SIZE, self.scale);
+        layout.set_alignment(Alignment::Center);
+        layout.set_text("Saver");
+
+        let mut text_options = TextOptions::new();
+        if self.enabled {
+            text_options.text_color(ACTIVE_TAB_FG);
+        } else {
+            text_options.text_color(INACTIVE_TAB_FG);
+        }
+        text_options.position(Position::new(x_padding, y_padding));
+        text_options.size(Size::new(width.round() as i32, height.round() as i32));
+        builder.rasterize(&layout, &text_options);
+
+        builder.build()
+    }
+
+    /// Set the physical size and scale of the button.
+    fn set_geometry(&mut self, size: Size, scale: f64) {
+        self.size = size;
+        self.scale = scale;
+
+        // Force redraw.
+        self.dirty = true;
+    }
+}
+
 /// Touch event tracking.
 #[derive(Default)]
 struct TouchState {
@@ -666,4 +971,5 @@ enum TouchAction {
     TabTap,
     TabDrag,
     NewTabTap,
+    DataSaverTap,
 }
@@ -1,6 +1,6 @@
 //! OpenGL UI rendering.
 
-use std::ffi::{CStr, CString};
+use std::ffi::{c_void, CStr, CString};
 use std::num::NonZeroU32;
 use std::ops::{Deref, Range};
 use std::ptr::NonNull;
@@ -125,6 +125,48 @@ impl Renderer {
 
         gl::DrawArrays(gl::TRIANGLES, 0, 6);
     }
+
+    /// Render texture into a render texture.
+    ///
+    /// The texture is scaled to fill the target's width, cropping everything
+    /// below the target's height. Uncovered areas are filled with `background`.
+    pub unsafe fn draw_texture_to(
+        &self,
+        target: &RenderTexture,
+        texture: &Texture,
+        background: [f64; 3],
+    ) {
+        // Fail before renderer initialization.
+        let sized = match &self.sized {
+            Some(sized) => sized,
+            None => unreachable!(),
+        };
+
+        let width = target.texture.width as f32;
+        let height = target.texture.height as f32;
+
+        gl::BindFramebuffer(gl::FRAMEBUFFER, target.framebuffer);
+        gl::Viewport(0, 0, width as i32, height as i32);
+
+        let [r, g, b] = background;
+        gl::ClearColor(r as f32, g as f32, b as f32, 1.0);
+        gl::Clear(gl::COLOR_BUFFER_BIT);
+
+        // Scale texture to the target width, while flipping it vertically since
+        // framebuffer rows start at the bottom.
+        let y_scale = width * texture.height as f32 / texture.width as f32 / height;
+        let matrix = [1., 0., 0., -y_scale];
+        gl::UniformMatrix2fv(sized.uniform_matrix, 1, gl::FALSE, matrix.as_ptr());
+        gl::Uniform2fv(sized.uniform_position, 1, [0., -2.].as_ptr());
+
+        gl::BindTexture(gl::TEXTURE_2D, texture.id);
+
+        gl::DrawArrays(gl::TRIANGLES, 0, 6);
+
+        // Restore the surface's framebuffer.
+        gl::BindFramebuffer(gl::FRAMEBUFFER, 0);
+        gl::Viewport(0, 0, sized.size.width as i32, sized.size.height as i32);
+    }
 }
 
 /// Render state requiring known size.
@@ -338,6 +380,32 @@ impl Texture {
         }
     }
 
+    /// Import an EGLImage as texture.
+    ///
+    /// The texture shares the image's storage, so no pixels are copied.
+    ///
+    /// Returns `None` if the context does not support EGLImage textures.
+    pub unsafe fn from_egl_image(
+        image: *const c_void,
+        width: usize,
+        height: usize,
+    ) -> Option<Self> {
+        if !gl::EGLImageTargetTexture2DOES::is_loaded() {
+            return None;
+        }
+
+        let mut id = 0;
+        gl::GenTextures(1, &mut id);
+        gl::BindTexture(gl::TEXTURE_2D, id);
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE as i32);
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE as i32);
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::LINEAR as i32);
+        gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::LINEAR as i32);
+        gl::EGLImageTargetTexture2DOES(gl::TEXTURE_2D, image);
+
+        Some(Self { id, width, height })
+    }
+
     /// Delete this texture.
     ///
     /// Since texture ID are context-specific, the context must be bound when
@@ -349,6 +417,56 @@ impl Texture {
     }
 }
 
+/// OpenGL texture which can be rendered into.
+#[derive(Debug)]
+pub struct RenderTexture {
+    pub texture: Texture,
+    framebuffer: u32,
+}
+
+impl RenderTexture {
+    /// Create an empty render texture.
+    pub fn new(width: usize, height: usize) -> Self {
+        unsafe {
+            let mut id = 0;
+            gl::GenTextures(1, &mut id);
+            gl::BindTexture(gl::TEXTURE_2D, id);
+            gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE as i32);
+            gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE as i32);
+            gl::TexImage2D(
+                gl::TEXTURE_2D,
+                0,
+                gl::RGBA as i32,
+                width as i32,
+                height as i32,
+                0,
+                gl::RGBA,
+                gl::UNSIGNED_BYTE,
+                ptr::null(),
+            );
+            gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::LINEAR as i32);
+            gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::LINEAR as i32);
+
+            let mut framebuffer = 0;
+            gl::GenFramebuffers(1, &mut framebuffer);
+            gl::BindFramebuffer(gl::FRAMEBUFFER, framebuffer);
+            gl::FramebufferTexture2D(gl::FRAMEBUFFER, gl::COLOR_ATTACHMENT0, gl::TEXTURE_2D, id, 0);
+            gl::BindFramebuffer(gl::FRAMEBUFFER, 0);
+
+            Self { texture: Texture { id, width, height }, framebuffer }
+        }
+    }
+
+    /// Delete this texture and its framebuffer.
+    ///
+    /// Since texture ID are context-specific, the context must be bound when
+    /// calling this function.
+    pub fn delete(&self) {
+        self.texture.delete();
+        unsafe { gl::DeleteFramebuffers(1, &self.framebuffer) };
+    }
+}
+
 /// Cairo-based graphics rendering.
 pub struct TextureBuilder {
     image_surface: ImageSurface,
@@ -58,7 +58,8 @@ impl State {
         loop {
             match queue.dispatch_pending(self) {
                 Ok(0) => break,
-                Ok(_) => (),
+                // Input and frame callbacks delay background work.
+                Ok(_) => self.storage_cleanup.activity(),
                 Err(DispatchError::Backend(err)) => return Err(err),
                 Err(DispatchError::BadMessage { .. }) => (),
             }
@@ -0,0 +1,246 @@
+//! Handling of the linux-dmabuf protocol.
+
+use std::fs::File;
+use std::io::Read;
+use std::mem;
+use std::os::fd::{AsFd, OwnedFd};
+use std::sync::{Arc, Mutex};
+
+use smithay_client_toolkit::globals::GlobalData;
+use smithay_client_toolkit::reexports::client::globals::{BindError, GlobalList};
+use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
+use smithay_client_toolkit::reexports::client::protocol::wl_surface::WlSurface;
+use smithay_client_toolkit::reexports::client::{
+    delegate_dispatch, event_created_child, Connection, Dispatch, Proxy, QueueHandle, WEnum,
+};
+use smithay_client_toolkit::reexports::protocols::wp::linux_dmabuf::zv1::client::zwp_linux_buffer_params_v1::{
+    self, Flags, ZwpLinuxBufferParamsV1,
+};
+use smithay_client_toolkit::reexports::protocols::wp::linux_dmabuf::zv1::client::zwp_linux_dmabuf_feedback_v1::{
+    self, TrancheFlags, ZwpLinuxDmabufFeedbackV1,
+};
+use smithay_client_toolkit::reexports::protocols::wp::linux_dmabuf::zv1::client::zwp_linux_dmabuf_v1::{
+    self, ZwpLinuxDmabufV1,
+};
+use tracing::{error, trace};
+
+use crate::{Size, State};
+
+/// Size of a single format table entry in bytes.
+const FORMAT_TABLE_ENTRY_SIZE: usize = 16;
+
+/// Linux dmabuf manager.
+#[derive(Debug)]
+pub struct Dmabuf {
+    dmabuf: ZwpLinuxDmabufV1,
+    queue: QueueHandle<State>,
+
+    /// Formats advertised by protocol versions without feedback support.
+    formats: Arc<Mutex<DmabufFormats>>,
+}
+
+impl Dmabuf {
+    /// Create new dmabuf manager.
+    pub fn new(globals: &GlobalList, queue_handle: &QueueHandle<State>) -> Result<Self, BindError> {
+        let formats = Arc::new(Mutex::new(DmabufFormats::default()));
+        let dmabuf = globals.bind(queue_handle, 3..=4, formats.clone())?;
+        Ok(Self { dmabuf, formats, queue: queue_handle.clone() })
+    }
+
+    /// Get the buffer import feedback for a surface.
+    pub fn surface_feedback(&self, surface: &WlSurface) -> DmabufFeedback {
+        // Fall back to the global format list without feedback support.
+        let formats = if self.dmabuf.version() >= 4 {
+            let formats = Arc::new(Mutex::new(DmabufFormats::default()));
+            self.dmabuf.get_surface_feedback(surface, &self.queue, formats.clone());
+            formats
+        } else {
+            self.formats.clone()
+        };
+
+        DmabufFeedback { dmabuf: self.dmabuf.clone(), queue: self.queue.clone(), formats }
+    }
+}
+
+/// Compositor feedback for dmabuf imports to a surface.
+#[derive(Clone, Debug)]
+pub struct DmabufFeedback {
+    dmabuf: ZwpLinuxDmabufV1,
+    queue: QueueHandle<State>,
+    formats: Arc<Mutex<DmabufFormats>>,
+}
+
+impl DmabufFeedback {
+    /// Create a Wayland buffer from dmabuf planes.
+    ///
+    /// Returns `None` if the compositor does not support the buffer's format
+    /// and modifier combination.
+    pub fn create_buffer<U>(&self, buffer: &DmabufBuffer, data: U) -> Option<WlBuffer>
+    where
+        State: Dispatch<WlBuffer, U>,
+        U: Send + Sync + 'static,
+    {
+        let format = (buffer.format, buffer.modifier);
+        {
+            let formats = self.formats.lock().unwrap();
+            if !formats.supported.contains(&format) {
+                return None;
+            }
+
+            if !formats.scanout.contains(&format) {
+                trace!("Dmabuf format {format:?} is not scanout capable");
+            }
+        }
+
+        let params = self.dmabuf.create_params(&self.queue, GlobalData);
+        let (modifier_hi, modifier_lo) = ((buffer.modifier >> 32) as u32, buffer.modifier as u32);
+        for (i, plane) in buffer.planes.iter().enumerate() {
+            let fd = plane.fd.as_fd();
+            params.add(fd, i as u32, plane.offset, plane.stride, modifier_hi, modifier_lo);
+        }
+
+        let (width, height) = (buffer.size.width as i32, buffer.size.height as i32);
+        let wl_buffer =
+            params.create_immed(width, height, buffer.format, Flags::empty(), &self.queue, data);
+        params.destroy();
+
+        Some(wl_buffer)
+    }
+}
+
+/// Buffer exported as dmabuf.
+#[derive(Debug)]
+pub struct DmabufBuffer {
+    pub size: Size,
+    /// DRM fourcc format.
+    pub format: u32,
+    /// DRM format modifier.
+    pub modifier: u64,
+    pub planes: Vec<DmabufPlane>,
+}
+
+/// Single plane of a dmabuf buffer.
+#[derive(Debug)]
+pub struct DmabufPlane {
+    pub fd: OwnedFd,
+    pub offset: u32,
+    pub stride: u32,
+}
+
+/// Format and modifier combinations supported by the compositor.
+#[derive(Default, Debug)]
+pub struct DmabufFormats {
+    /// Formats supported for import.
+    supported: Vec<(u32, u64)>,
+    /// Formats the compositor can scan out directly.
+    scanout: Vec<(u32, u64)>,
+
+    // Feedback state until the next `done` event.
+    table: Vec<(u32, u64)>,
+    pending_supported: Vec<(u32, u64)>,
+    pending_scanout: Vec<(u32, u64)>,
+    tranche_formats: Vec<(u32, u64)>,
+    tranche_scanout: bool,
+}
+
+impl DmabufFormats {
+    /// Load the format table shared through a file descriptor.
+    fn load_table(&mut self, fd: OwnedFd, size: u32) {
+        let mut data = vec![0; size as usize];
+        if let Err(err) = File::from(fd).read_exact(&mut data) {
+            error!("Could not read dmabuf format table: {err}");
+            return;
+        }
+
+        self.table = data
+            .chunks_exact(FORMAT_TABLE_ENTRY_SIZE)
+            .map(|entry| {
+                let format = u32::from_ne_bytes(entry[..4].try_into().unwrap());
+                let modifier = u64::from_ne_bytes(entry[8..].try_into().unwrap());
+                (format, modifier)
+            })
+            .collect();
+    }
+}
+
+impl Dispatch<ZwpLinuxDmabufV1, Arc<Mutex<DmabufFormats>>, State> for Dmabuf {
+    fn event(
+        _: &mut State,
+        _: &ZwpLinuxDmabufV1,
+        event: zwp_linux_dmabuf_v1::Event,
+        formats: &Arc<Mutex<DmabufFormats>>,
+        _: &Connection,
+        _: &QueueHandle<State>,
+    ) {
+        // Modifier events are only sent without feedback support.
+        if let zwp_linux_dmabuf_v1::Event::Modifier { format, modifier_hi, modifier_lo } = event {
+            let modifier = ((modifier_hi as u64) << 32) | modifier_lo as u64;
+            formats.lock().unwrap().supported.push((format, modifier));
+        }
+    }
+}
+
+impl Dispatch<ZwpLinuxDmabufFeedbackV1, Arc<Mutex<DmabufFormats>>, State> for Dmabuf {
+    fn event(
+        _: &mut State,
+        _: &ZwpLinuxDmabufFeedbackV1,
+        event: zwp_linux_dmabuf_feedback_v1::Event,
+        formats: &Arc<Mutex<DmabufFormats>>,
+        _: &Connection,
+        _: &QueueHandle<State>,
+    ) {
+        let formats = &mut *formats.lock().unwrap();
+        match event {
+            zwp_linux_dmabuf_feedback_v1::Event::FormatTable { fd, size } => {
+                formats.load_table(fd, size);
+            },
+            zwp_linux_dmabuf_feedback_v1::Event::TrancheFormats { indices } => {
+                let tranche_formats = indices
+                    .chunks_exact(2)
+                    .map(|index| u16::from_ne_bytes([index[0], index[1]]) as usize)
+                    .filter_map(|index| formats.table.get(index).copied());
+                formats.tranche_formats.extend(tranche_formats);
+            },
+            zwp_linux_dmabuf_feedback_v1::Event::TrancheFlags { flags } => {
+                formats.tranche_scanout =
+                    matches!(flags, WEnum::Value(flags) if flags.contains(TrancheFlags::Scanout));
+            },
+            zwp_linux_dmabuf_feedback_v1::Event::TrancheDone => {
+                if formats.tranche_scanout {
+                    formats.pending_scanout.extend_from_slice(&formats.tranche_formats);
+                }
+                let tranche_formats = formats.tranche_formats.drain(..);
+                formats.pending_supported.extend(tranche_formats);
+                formats.tranche_scanout = false;
+            },
+            zwp_linux_dmabuf_feedback_v1::Event::Done => {
+                formats.supported = mem::take(&mut formats.pending_supported);
+                formats.scanout = mem::take(&mut formats.pending_scanout);
+            },
+            _ => (),
+        }
+    }
+}
+
+impl Dispatch<ZwpLinuxBufferParamsV1, GlobalData, State> for Dmabuf {
+    event_created_child!(State, ZwpLinuxBufferParamsV1, [
+        zwp_linux_buffer_params_v1::EVT_CREATED_OPCODE => (WlBuffer, GlobalData),
+    ]);
+
+    fn event(
+        _: &mut State,
+        _: &ZwpLinuxBufferParamsV1,
+        event: zwp_linux_buffer_params_v1::Event,
+        _: &GlobalData,
+        _: &Connection,
+        _: &QueueHandle<State>,
+    ) {
+        if let zwp_linux_buffer_params_v1::Event::Failed = event {
+            error!("Dmabuf buffer creation failed");
+        }
+    }
+}
+
+delegate_dispatch!(State: [ZwpLinuxDmabufV1: Arc<Mutex<DmabufFormats>>] => Dmabuf);
+delegate_dispatch!(State: [ZwpLinuxDmabufFeedbackV1: Arc<Mutex<DmabufFormats>>] => Dmabuf);
+delegate_dispatch!(State: [ZwpLinuxBufferParamsV1: GlobalData] => Dmabuf);
@@ -6,9 +6,10 @@ use std::sync::{Arc, Mutex};
 use _text_input::zwp_text_input_manager_v3::{self, ZwpTextInputManagerV3};
 use _text_input::zwp_text_input_v3::{self, ZwpTextInputV3};
 use smithay_client_toolkit::compositor::{CompositorHandler, CompositorState};
+use smithay_client_toolkit::globals::GlobalData;
 use smithay_client_toolkit::output::{OutputHandler, OutputState};
 use smithay_client_toolkit::reexports::client::globals::GlobalList;
-use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
+use smithay_client_toolkit::reexports::client::protocol::wl_buffer::{self, WlBuffer};
 use smithay_client_toolkit::reexports::client::protocol::wl_keyboard::WlKeyboard;
 use smithay_client_toolkit::reexports::client::protocol::wl_output::{Transform, WlOutput};
 use smithay_client_toolkit::reexports::client::protocol::wl_pointer::WlPointer;
@@ -35,12 +36,19 @@ use smithay_client_toolkit::{
 use wayland_backend::client::{Backend, ObjectData, ObjectId};
 use wayland_backend::protocol::Message;
 
+use crate::engine::webkit::video_plane::VideoFrame;
+use crate::wayland::protocols::dmabuf::Dmabuf;
 use crate::wayland::protocols::fractional_scale::{FractionalScaleHandler, FractionalScaleManager};
+use crate::wayland::protocols::presentation::{Presentation, PresentationHandler};
+use crate::wayland::protocols::single_pixel_buffer::SinglePixelBufferManager;
 use crate::wayland::protocols::viewporter::Viewporter;
 use crate::window::WindowHandler as _;
 use crate::{KeyboardState, State};
 
+pub mod dmabuf;
 pub mod fractional_scale;
+pub mod presentation;
+pub mod single_pixel_buffer;
 pub mod viewporter;
 
 #[derive(Debug)]
@@ -50,6 +58,9 @@ pub struct ProtocolStates {
     pub compositor: CompositorState,
     pub viewporter: Viewporter,
     pub xdg_shell: XdgShell,
+    pub single_pixel_buffer: Option<SinglePixelBufferManager>,
+    pub dmabuf: Option<Dmabuf>,
+    pub presentation: Option<Presentation>,
 
     text_input: TextInputManager,
     registry: RegistryState,
@@ -69,6 +80,9 @@ impl ProtocolStates {
         let xdg_shell = XdgShell::bind(globals, queue).unwrap();
         let output = OutputState::new(globals, queue);
         let seat = SeatState::new(globals, queue);
+        let single_pixel_buffer = SinglePixelBufferManager::new(globals, queue).ok();
+        let dmabuf = Dmabuf::new(globals, queue).ok();
+        let presentation = Presentation::new(globals, queue).ok();
 
         Self {
             fractional_scale,
@@ -78,6 +92,9 @@ impl ProtocolStates {
             text_input,
             xdg_shell,
             registry,
+            single_pixel_buffer,
+            dmabuf,
+            presentation,
             output,
             seat,
         }
@@ -90,11 +107,11 @@ impl CompositorHandler for State {
         _connection: &Connection,
         _queue: &QueueHandle<Self>,
         surface: &WlSurface,
-        _serial: u32,
+        time: u32,
     ) {
         let window = self.windows.values_mut().find(|window| window.owns_surface(surface));
         if let Some(window) = window {
-            window.draw();
+            window.frame(time);
         }
     }
 
@@ -192,6 +209,15 @@ impl FractionalScaleHandler for State {
     }
 }
 
+impl PresentationHandler for State {
+    fn presented(&mut self, surface: &WlSurface, time: u32, refresh: u32) {
+        let window = self.windows.values_mut().find(|w| w.owns_surface(surface));
+        if let Some(window) = window {
+            window.presented(time, refresh);
+        }
+    }
+}
+
 impl SeatHandler for State {
     fn seat_state(&mut self) -> &mut SeatState {
         &mut self.protocol_states.seat
@@ -727,14 +753,59 @@ impl Dispatch<ZwpTextInputV3, Arc<Mutex<TextInputState>>> for State {
     }
 }
 
-/// Foreign WlBuffer object data.
-pub struct BufferData {
-    connection: Connection,
+impl Dispatch<WlBuffer, GlobalData> for State {
+    fn event(
+        _: &mut Self,
+        _: &WlBuffer,
+        _: <WlBuffer as Proxy>::Event,
+        _: &GlobalData,
+        _: &Connection,
+        _: &QueueHandle<Self>,
+    ) {
+        // Buffers are reused after their release, so release events are
+        // ignored.
+    }
+}
+
+/// Hole-punched video frame buffer data.
+#[derive(Default)]
+pub struct VideoBufferData {
+    frame: Mutex<Option<VideoFrame>>,
 }
 
+impl VideoBufferData {
+    /// Keep a video frame alive until the buffer is released.
+    pub fn set_frame(&self, frame: VideoFrame) {
+        *self.frame.lock().unwrap() = Some(frame);
+    }
+}
+
+impl Dispatch<WlBuffer, VideoBufferData> for State {
+    fn event(
+        _: &mut Self,
+        buffer: &WlBuffer,
+        event: <WlBuffer as Proxy>::Event,
+        data: &VideoBufferData,
+        _: &Connection,
+        _: &QueueHandle<Self>,
+    ) {
+        // Return the frame to the video decoder once the compositor is done with it.
+        if let wl_buffer::Event::Release = event {
+            data.frame.lock().unwrap().take();
+            buffer.destroy();
+        }
+    }
+}
+
+/// Foreign WlBuffer object data.
+///
+/// Buffers are reused after their release, so they are never destroyed
+/// automatically.
+pub struct BufferData;
+
 impl BufferData {
-    pub fn new(connection: Connection) -> Arc<Self> {
-        Arc::new(Self { connection })
+    pub fn new() -> Arc<Self> {
+        Arc::new(Self)
     }
 }
 
@@ -742,15 +813,8 @@ impl ObjectData for BufferData {
     fn event(
         self: Arc<Self>,
         _backend: &Backend,
-        msg: Message<ObjectId, OwnedFd>,
+        _msg: Message<ObjectId, OwnedFd>,
     ) -> Option<Arc<dyn ObjectData>> {
-        // Destroy buffer on release.
-        if msg.opcode == 0 {
-            if let Ok(buffer) = WlBuffer::from_id(&self.connection, msg.sender_id) {
-                buffer.destroy();
-            }
-        }
-
         None
     }
 
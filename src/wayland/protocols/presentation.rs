@@ -0,0 +1,99 @@
+//! Handling of the presentation time protocol.
+
+use std::sync::atomic::{AtomicI64, Ordering};
+use std::sync::Arc;
+
+use smithay_client_toolkit::globals::GlobalData;
+use smithay_client_toolkit::reexports::client::globals::{BindError, GlobalList};
+use smithay_client_toolkit::reexports::client::protocol::wl_surface::WlSurface;
+use smithay_client_toolkit::reexports::client::{
+    delegate_dispatch, Connection, Dispatch, Proxy, QueueHandle,
+};
+use smithay_client_toolkit::reexports::protocols::wp::presentation_time::client::wp_presentation::{
+    Event as PresentationEvent, WpPresentation,
+};
+use smithay_client_toolkit::reexports::protocols::wp::presentation_time::client::wp_presentation_feedback::{
+    Event as FeedbackEvent, WpPresentationFeedback,
+};
+
+use crate::State;
+
+/// Handle presentation feedback events.
+pub trait PresentationHandler: Sized {
+    /// Surface content was shown on screen.
+    ///
+    /// The `time` is in milliseconds of the presentation clock, `refresh` is
+    /// the output's refresh interval in nanoseconds, or zero if unknown.
+    fn presented(&mut self, surface: &WlSurface, time: u32, refresh: u32);
+}
+
+/// Presentation time manager.
+#[derive(Clone, Debug)]
+pub struct Presentation {
+    presentation: WpPresentation,
+    clock_id: Arc<AtomicI64>,
+}
+
+impl Presentation {
+    /// Create new presentation time manager.
+    pub fn new(globals: &GlobalList, queue_handle: &QueueHandle<State>) -> Result<Self, BindError> {
+        let presentation = globals.bind(queue_handle, 1..=1, GlobalData)?;
+        Ok(Self { presentation, clock_id: Arc::new(AtomicI64::new(-1)) })
+    }
+
+    /// Request presentation feedback for the next commit of a surface.
+    pub fn feedback(&self, queue_handle: &QueueHandle<State>, surface: &WlSurface) {
+        let data = PresentationFeedback { surface: surface.clone() };
+        self.presentation.feedback(surface, queue_handle, data);
+    }
+
+    /// Clock used for presentation timestamps.
+    ///
+    /// This is `None` until the compositor has announced its clock.
+    pub fn clock_id(&self) -> Option<libc::clockid_t> {
+        let clock_id = self.clock_id.load(Ordering::Relaxed);
+        (clock_id >= 0).then_some(clock_id as libc::clockid_t)
+    }
+}
+
+impl Dispatch<WpPresentation, GlobalData, State> for Presentation {
+    fn event(
+        state: &mut State,
+        _: &WpPresentation,
+        event: <WpPresentation as Proxy>::Event,
+        _: &GlobalData,
+        _: &Connection,
+        _: &QueueHandle<State>,
+    ) {
+        if let PresentationEvent::ClockId { clk_id } = event {
+            if let Some(presentation) = &state.protocol_states.presentation {
+                presentation.clock_id.store(clk_id as i64, Ordering::Relaxed);
+            }
+        }
+    }
+}
+
+pub struct PresentationFeedback {
+    surface: WlSurface,
+}
+
+impl Dispatch<WpPresentationFeedback, PresentationFeedback, State> for PresentationFeedback {
+    fn event(
+        state: &mut State,
+        _: &WpPresentationFeedback,
+        event: <WpPresentationFeedback as Proxy>::Event,
+        data: &PresentationFeedback,
+        _: &Connection,
+        _: &QueueHandle<State>,
+    ) {
+        if let FeedbackEvent::Presented { tv_sec_hi, tv_sec_lo, tv_nsec, refresh, .. } = event {
+            // Truncate to milliseconds, like Wayland's input and frame timestamps.
+            let secs = ((tv_sec_hi as u64) << 32) | tv_sec_lo as u64;
+            let millis = secs.wrapping_mul(1000).wrapping_add(tv_nsec as u64 / 1_000_000);
+            state.presented(&data.surface, millis as u32, refresh);
+        }
+    }
+}
+
+delegate_dispatch!(State: [WpPresentation: GlobalData] => Presentation);
+delegate_dispatch!(State: [WpPresentationFeedback: PresentationFeedback] => PresentationFeedback);
@@ -0,0 +1,46 @@
+//! Handling of the single pixel buffer protocol.
+
+use smithay_client_toolkit::globals::GlobalData;
+use smithay_client_toolkit::reexports::client::globals::{BindError, GlobalList};
+use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
+use smithay_client_toolkit::reexports::client::{
+    delegate_dispatch, Connection, Dispatch, Proxy, QueueHandle,
+};
+use smithay_client_toolkit::reexports::protocols::wp::single_pixel_buffer::v1::client::wp_single_pixel_buffer_manager_v1::WpSinglePixelBufferManagerV1;
+
+use crate::State;
+
+/// Single pixel buffer manager.
+#[derive(Debug)]
+pub struct SinglePixelBufferManager {
+    manager: WpSinglePixelBufferManagerV1,
+}
+
+impl SinglePixelBufferManager {
+    /// Create new single pixel buffer manager.
+    pub fn new(globals: &GlobalList, queue_handle: &QueueHandle<State>) -> Result<Self, BindError> {
+        let manager = globals.bind(queue_handle, 1..=1, GlobalData)?;
+        Ok(Self { manager })
+    }
+
+    /// Create a 1x1 buffer with an opaque RGB color.
+    pub fn create_buffer(&self, queue_handle: &QueueHandle<State>, color: [f64; 3]) -> WlBuffer {
+        let [r, g, b] = color.map(|channel| (channel.clamp(0., 1.) * u32::MAX as f64) as u32);
+        self.manager.create_u32_rgba_buffer(r, g, b, u32::MAX, queue_handle, GlobalData)
+    }
+}
+
+impl Dispatch<WpSinglePixelBufferManagerV1, GlobalData, State> for SinglePixelBufferManager {
+    fn event(
+        _: &mut State,
+        _: &WpSinglePixelBufferManagerV1,
+        _: <WpSinglePixelBufferManagerV1 as Proxy>::Event,
+        _: &GlobalData,
+        _: &Connection,
+        _: &QueueHandle<State>,
+    ) {
+        // No events.
+    }
+}
+
+delegate_dispatch!(State: [WpSinglePixelBufferManagerV1: GlobalData] => SinglePixelBufferManager);
@@ -1,16 +1,20 @@
 //! Browser window handling.
 
 use std::borrow::Cow;
-use std::collections::HashMap;
 use std::mem;
 use std::ops::Range;
 use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::Duration;
 
 use _text_input::zwp_text_input_v3::{ChangeCause, ContentHint, ContentPurpose, ZwpTextInputV3};
 use funq::StQueueHandle;
+use glib::{source, ControlFlow, Priority, Source};
 use glutin::display::Display;
 use indexmap::IndexMap;
 use smallvec::SmallVec;
+use smithay_client_toolkit::compositor::{CompositorState, Region};
+use smithay_client_toolkit::reexports::client::protocol::wl_buffer::WlBuffer;
+use smithay_client_toolkit::reexports::client::protocol::wl_subsurface::WlSubsurface;
 use smithay_client_toolkit::reexports::client::protocol::wl_surface::WlSurface;
 use smithay_client_toolkit::reexports::client::{Connection, QueueHandle};
 use smithay_client_toolkit::reexports::csd_frame::WindowState;
@@ -22,16 +26,24 @@ use smithay_client_toolkit::shell::xdg::window::{
     Window as XdgWindow, WindowConfigure, WindowDecorations,
 };
 use smithay_client_toolkit::shell::WaylandSurface;
+use tracing::{error, info, warn};
 
+use crate::config::Config;
+use crate::engine::placeholder::PlaceholderEngine;
+use crate::engine::webkit::video_plane::VideoFrame;
 use crate::engine::webkit::{WebKitEngine, WebKitError};
-use crate::engine::{Engine, EngineId};
+use crate::engine::{Engine, EngineId, BG};
 use crate::history::{HistoryMatch, MAX_MATCHES};
+use crate::input::{FrameClock, PendingInput, Pinch, TouchPoints, RESAMPLE_LATENCY};
+use crate::session::{SessionEvent, SessionHandler, TabSession, WindowSession};
 use crate::ui::overlay::option_menu::{Borders, OptionMenuId, OptionMenuItem, ScrollTarget};
 use crate::ui::overlay::Overlay;
 use crate::ui::{Ui, TOOLBAR_HEIGHT};
 use crate::uri::{SCHEMES, TLDS};
-use crate::wayland::protocols::ProtocolStates;
-use crate::{History, Position, Size, State};
+use crate::wayland::protocols::dmabuf::DmabufFeedback;
+use crate::wayland::protocols::presentation::Presentation;
+use crate::wayland::protocols::{ProtocolStates, VideoBufferData};
+use crate::{memory, History, Position, Size, State};
 
 /// Search engine base URI.
 const SEARCH_URI: &str = "https://duckduckgo.com/?q=";
@@ -40,14 +52,59 @@ const SEARCH_URI: &str = "https://duckduckgo.com/?q=";
 const DEFAULT_WIDTH: u32 = 1280;
 const DEFAULT_HEIGHT: u32 = 720;
 
+/// Time a URI bar suggestion must remain stable before it is prerendered.
+const PRERENDER_DELAY: Duration = Duration::from_millis(500);
+
+/// Time without size changes before engines are resized.
+const RESIZE_DEBOUNCE: Duration = Duration::from_millis(100);
+
+/// Time without pinch changes before the engine renders the pinch.
+const PINCH_COMMIT_DELAY: Duration = Duration::from_millis(150);
+
+/// Maximum time a finished pinch is previewed while waiting for the engine.
+const PINCH_PREVIEW_TIMEOUT: Duration = Duration::from_secs(1);
+
+/// Maximum number of idle engines kept ready for new tabs.
+const MAX_ENGINE_POOL_SIZE: usize = 2;
+
+/// Available memory in MiB required for each pooled engine.
+///
+/// One additional engine's worth of memory is always kept free.
+const POOL_ENGINE_MEMORY_MB: u64 = 512;
+
+/// Interval between checks for pooled engines exceeding the available memory.
+const POOL_TRIM_INTERVAL: u32 = 10;
+
 #[funq::callbacks(State)]
 pub trait WindowHandler {
     /// Close a browser window.
     fn close_window(&mut self, window_id: WindowId);
+
+    /// Start prerendering the staged URI bar suggestion.
+    fn start_prerender(&mut self, window_id: WindowId);
+
+    /// Add an idle engine to the window's engine pool.
+    fn fill_engine_pool(&mut self, window_id: WindowId);
+
+    /// Release pooled engines of all windows under memory pressure.
+    fn trim_engine_pools(&mut self);
+
+    /// Apply the window's settled size to its engines.
+    fn resize_engines(&mut self, window_id: WindowId);
+
+    /// Handle pinch gestures without recent changes.
+    fn pinch_timeout(&mut self, window_id: WindowId);
 }
 
 impl WindowHandler for State {
     fn close_window(&mut self, window_id: WindowId) {
+        // Persist the last window's tabs, so they can be restored.
+        if self.windows.len() == 1 && self.windows.contains_key(&window_id) {
+            self.save_session();
+        } else {
+            self.log_session_event(SessionEvent::WindowClosed { window: window_id.raw() });
+        }
+
         // Remove the window and mark it as closed.
         self.windows.retain(|id, window| {
             let retain = *id != window_id;
@@ -62,6 +119,36 @@ impl WindowHandler for State {
             self.main_loop.quit();
         }
     }
+
+    fn start_prerender(&mut self, window_id: WindowId) {
+        if let Some(window) = self.windows.get_mut(&window_id) {
+            window.start_prerender();
+        }
+    }
+
+    fn fill_engine_pool(&mut self, window_id: WindowId) {
+        if let Some(window) = self.windows.get_mut(&window_id) {
+            window.fill_engine_pool();
+        }
+    }
+
+    fn trim_engine_pools(&mut self) {
+        for window in self.windows.values_mut() {
+            window.trim_engine_pool();
+        }
+    }
+
+    fn resize_engines(&mut self, window_id: WindowId) {
+        if let Some(window) = self.windows.get_mut(&window_id) {
+            window.resize_engines();
+        }
+    }
+
+    fn pinch_timeout(&mut self, window_id: WindowId) {
+        if let Some(window) = self.windows.get_mut(&window_id) {
+            window.pinch_timeout();
+        }
+    }
 }
 
 /// Wayland window.
@@ -70,6 +157,9 @@ pub struct Window {
 
     tabs: IndexMap<EngineId, Box<dyn Engine>>,
     active_tab: EngineId,
+    prerender: Prerender,
+    engine_pool: Vec<Box<dyn Engine>>,
+    engine_pool_fill_pending: bool,
     overlay: Overlay,
 
     text_input: Option<TextInput>,
@@ -77,6 +167,19 @@ pub struct Window {
     initial_configure_done: bool,
     engine_viewport: WpViewport,
     engine_surface: WlSurface,
+    engine_bg_buffer: Option<WlBuffer>,
+    engine_resize_timeout: Option<Source>,
+    engine_cursor_rect: Option<(i32, i32, i32, i32)>,
+    keyboard_crop: Option<KeyboardCrop>,
+    dmabuf: Option<DmabufFeedback>,
+    video_subsurface: WlSubsurface,
+    video_viewport: WpViewport,
+    video_surface: WlSurface,
+    video_dmabuf: Option<DmabufFeedback>,
+    video_plane: Option<VideoPlane>,
+    engine_source: Option<(Position<f64>, Size<f64>)>,
+    presentation: Option<Presentation>,
+    compositor: CompositorState,
     connection: Connection,
     egl_display: Display,
     xdg: XdgWindow,
@@ -84,13 +187,25 @@ pub struct Window {
     size: Size,
 
     queue: StQueueHandle<State>,
+    history: History,
+    config: Config,
+    data_saver: bool,
+    data_saver_override: Option<bool>,
 
     ui: Ui,
     history_menu_matches: SmallVec<[HistoryMatch; MAX_MATCHES]>,
     history_menu: Option<OptionMenuId>,
 
     // Touch point position tracking.
-    touch_points: HashMap<i32, Position<f64>>,
+    touch_points: TouchPoints,
+
+    // Engine input awaiting the next frame.
+    pending_input: PendingInput,
+    frame_clock: FrameClock,
+    resample_time: Option<u32>,
+    pinch: Option<Pinch>,
+    pinch_motion: Option<(u32, i32, Modifiers)>,
+    pinch_timeout: Option<Source>,
     keyboard_focus: KeyboardFocus,
 
     fullscreen_request: Option<EngineId>,
@@ -109,6 +224,7 @@ impl Window {
         queue: StQueueHandle<State>,
         wayland_queue: QueueHandle<State>,
         history: History,
+        config: Config,
     ) -> Result<Self, WebKitError> {
         // Create UI renderer.
         let id = WindowId::new();
@@ -121,7 +237,7 @@ impl Window {
             surface.clone(),
             ui_viewport,
             protocol_states.compositor.clone(),
-            history,
+            history.clone(),
         );
 
         // Enable fractional scaling.
@@ -131,6 +247,28 @@ impl Window {
         let (_, engine_surface) =
             protocol_states.subcompositor.create_subsurface(surface.clone(), &wayland_queue);
         let engine_viewport = protocol_states.viewporter.viewport(&wayland_queue, &engine_surface);
+        let dmabuf =
+            protocol_states.dmabuf.as_ref().map(|dmabuf| dmabuf.surface_feedback(&engine_surface));
+
+        // Create surface for hole-punched video below the engine surface.
+        let (video_subsurface, video_surface) =
+            protocol_states.subcompositor.create_subsurface(surface.clone(), &wayland_queue);
+        video_subsurface.place_below(&engine_surface);
+        video_subsurface.set_desync();
+        let video_viewport = protocol_states.viewporter.viewport(&wayland_queue, &video_surface);
+        let video_dmabuf =
+            protocol_states.dmabuf.as_ref().map(|dmabuf| dmabuf.surface_feedback(&video_surface));
+
+        // Pass all input through to the engine surface.
+        if let Ok(region) = Region::new(&protocol_states.compositor) {
+            video_surface.set_input_region(Some(region.wl_region()));
+        }
+
+        // Create solid background buffer for engines without any frame.
+        let engine_bg_buffer = protocol_states
+            .single_pixel_buffer
+            .as_ref()
+            .map(|manager| manager.create_buffer(&wayland_queue, BG));
 
         // Create overlay UI surface.
         let (overlay_subsurface, overlay_surface) =
@@ -164,11 +302,23 @@ impl Window {
         let mut window = Self {
             engine_viewport,
             engine_surface,
+            engine_bg_buffer,
             wayland_queue,
             egl_display,
+            dmabuf,
+            video_subsurface,
+            video_viewport,
+            video_surface,
+            video_dmabuf,
+            presentation: protocol_states.presentation.clone(),
+            compositor: protocol_states.compositor.clone(),
             connection,
             active_tab,
             overlay,
+            history,
+            data_saver: config.data_saver.enabled(),
+            data_saver_override: Default::default(),
+            config,
             queue,
             size,
             xdg,
@@ -181,16 +331,35 @@ impl Window {
             fullscreen_request: Default::default(),
             keyboard_focus: Default::default(),
             history_menu: Default::default(),
+            pending_input: Default::default(),
+            resample_time: Default::default(),
+            pinch: Default::default(),
+            pinch_motion: Default::default(),
+            pinch_timeout: Default::default(),
+            frame_clock: Default::default(),
             touch_points: Default::default(),
             text_input: Default::default(),
             fullscreen: Default::default(),
+            engine_pool_fill_pending: Default::default(),
+            engine_resize_timeout: Default::default(),
+            engine_cursor_rect: Default::default(),
+            keyboard_crop: Default::default(),
+            video_plane: Default::default(),
+            engine_source: Default::default(),
+            engine_pool: Default::default(),
+            prerender: Default::default(),
             closed: Default::default(),
             dirty: Default::default(),
             tabs: Default::default(),
         };
 
         // Create initial browser tab.
+        window.queue.log_session_event(SessionEvent::WindowOpened { window: id.raw() });
         window.add_tab(true)?;
+        window.overlay.tabs_mut().set_data_saver(window.data_saver);
+
+        // Prepare engines for future tabs once idle.
+        window.schedule_engine_pool_fill();
 
         Ok(window)
     }
@@ -210,16 +379,220 @@ impl Window {
         &mut self.tabs
     }
 
+    /// Update the browser configuration.
+    pub fn set_config(&mut self, config: Config) {
+        // Apply profile changes to existing engines.
+        let profile = config.engine.profile;
+        if profile != self.config.engine.profile {
+            for engine in self.engines_mut() {
+                engine.set_profile(profile);
+            }
+        }
+
+        // Stop prerendering if it was disabled.
+        if !config.prerender.enabled {
+            self.discard_prerender();
+        }
+
+        self.set_data_saver(config.data_saver.enabled());
+
+        // Replace lazy loading scripts if their settings changed.
+        if config.lazy_loading != self.config.lazy_loading {
+            for engine in self.engines_mut() {
+                engine.set_lazy_loading(&config.lazy_loading);
+            }
+        }
+
+        if config.page_cache != self.config.page_cache {
+            for engine in self.engines_mut() {
+                engine.set_page_cache(config.page_cache);
+            }
+        }
+
+        if config.metrics.enabled != self.config.metrics.enabled {
+            for engine in self.engines_mut() {
+                engine.set_metrics(config.metrics.enabled);
+            }
+        }
+
+        self.config = config;
+    }
+
+    /// Update the data-saver from the global configuration.
+    ///
+    /// Windows where the data-saver was toggled manually keep their state.
+    pub fn set_data_saver(&mut self, enabled: bool) {
+        let enabled = self.data_saver_override.unwrap_or(enabled);
+        self.apply_data_saver(enabled);
+    }
+
+    /// Toggle the data-saver for this window only.
+    pub fn toggle_data_saver(&mut self) {
+        let enabled = !self.data_saver;
+        self.data_saver_override = Some(enabled);
+        self.apply_data_saver(enabled);
+    }
+
+    /// Toggle the data-saver for all of this window's engines.
+    fn apply_data_saver(&mut self, enabled: bool) {
+        if self.data_saver == enabled {
+            return;
+        }
+        self.data_saver = enabled;
+
+        for engine in self.engines_mut() {
+            engine.set_data_saver(enabled);
+        }
+
+        self.overlay.tabs_mut().set_data_saver(enabled);
+        if self.overlay.dirty() {
+            self.unstall();
+        }
+    }
+
+    /// Get mutable reference to any of this window's engines.
+    ///
+    /// Contrary to [`Self::tabs_mut`], this includes hidden engines which are
+    /// not part of the tabs list.
+    pub fn engine_mut(&mut self, engine_id: EngineId) -> Option<&mut Box<dyn Engine>> {
+        self.engines_mut().find(|engine| engine.id() == engine_id)
+    }
+
+    /// Iterate over all of this window's engines, including hidden ones.
+    fn engines_mut(&mut self) -> impl Iterator<Item = &mut Box<dyn Engine>> {
+        self.tabs.values_mut().chain(self.prerender.engine.as_mut()).chain(&mut self.engine_pool)
+    }
+
+    /// Create a new hidden browser engine.
+    ///
+    /// This will reuse an engine from the engine pool if one is available.
+    fn create_engine(&mut self) -> Result<Box<dyn Engine>, WebKitError> {
+        match self.engine_pool.pop() {
+            Some(engine) => {
+                self.schedule_engine_pool_fill();
+                Ok(engine)
+            },
+            None => self.new_engine(),
+        }
+    }
+
+    /// Build a new hidden browser engine.
+    ///
+    /// Once the web process limit is reached, the engine will share the web
+    /// process of the active tab.
+    fn new_engine(&mut self) -> Result<Box<dyn Engine>, WebKitError> {
+        let size = self.engine_layout_size();
+        let engine_id = EngineId::new(self.id);
+
+        let process_limit_reached = self.process_limit_reached();
+        let related = self
+            .tabs
+            .get_mut(&self.active_tab)
+            .filter(|_| process_limit_reached)
+            .and_then(|engine| engine.as_any().downcast_mut::<WebKitEngine>());
+
+        let mut engine = WebKitEngine::new(
+            &self.egl_display,
+            &self.connection,
+            self.queue.clone(),
+            engine_id,
+            size,
+            self.scale,
+            self.config.engine.profile,
+            related.as_deref(),
+            self.dmabuf.clone(),
+        )?;
+        engine.set_data_saver(self.data_saver);
+        engine.set_lazy_loading(&self.config.lazy_loading);
+        engine.set_page_cache(self.config.page_cache);
+        engine.set_metrics(self.config.metrics.enabled);
+        engine.set_visible(false);
+
+        Ok(Box::new(engine))
+    }
+
+    /// Check if this window's engines use up all permitted web processes.
+    fn process_limit_reached(&self) -> bool {
+        let max_processes = self.config.engine.max_processes as usize;
+        if max_processes == 0 {
+            return false;
+        }
+
+        let engines = self.tabs.values().chain(&self.prerender.engine).chain(&self.engine_pool);
+        let mut owners: SmallVec<[EngineId; 8]> =
+            engines.filter_map(|engine| engine.process_owner()).collect();
+        owners.sort_unstable();
+        owners.dedup();
+
+        owners.len() >= max_processes
+    }
+
+    /// Refill the engine pool in the background.
+    fn schedule_engine_pool_fill(&mut self) {
+        if self.engine_pool_fill_pending {
+            return;
+        }
+        self.engine_pool_fill_pending = true;
+
+        // Wait for idle, to avoid competing with the active page for resources.
+        let mut queue = self.queue.clone();
+        let window_id = self.id;
+        source::idle_add_local_full(Priority::LOW, move || {
+            queue.fill_engine_pool(window_id);
+            ControlFlow::Break
+        });
+    }
+
+    /// Create one engine for the engine pool.
+    pub fn fill_engine_pool(&mut self) {
+        self.engine_pool_fill_pending = false;
+
+        // Release pooled engines under memory pressure.
+        let pool_size = engine_pool_size();
+        if self.engine_pool.len() >= pool_size {
+            self.engine_pool.truncate(pool_size);
+            return;
+        }
+
+        // Pooled engines sharing a web process would not save any startup time.
+        if self.process_limit_reached() {
+            return;
+        }
+
+        match self.new_engine() {
+            Ok(engine) => self.engine_pool.push(engine),
+            Err(err) => {
+                error!("Could not create pooled engine: {err}");
+                return;
+            },
+        }
+
+        // Continue until the pool is full.
+        if self.engine_pool.len() < pool_size {
+            self.schedule_engine_pool_fill();
+        }
+    }
+
+    /// Release pooled engines exceeding the available memory.
+    pub fn trim_engine_pool(&mut self) {
+        let pool_size = engine_pool_size();
+        if self.engine_pool.len() > pool_size {
+            self.engine_pool.truncate(pool_size);
+        }
+    }
+
     /// Add a tab to the window.
     pub fn add_tab(&mut self, focus_uribar: bool) -> Result<EngineId, WebKitError> {
-        // Create a new browser engine.
-        let size = self.engine_size();
-        let engine_id = EngineId::new(self.id);
-        let engine =
-            WebKitEngine::new(&self.egl_display, self.queue.clone(), engine_id, size, self.scale)?;
-        self.tabs.insert(engine_id, Box::new(engine));
+        // Get a new browser engine.
+        let mut engine = self.create_engine()?;
+        engine.set_visible(true);
+        let engine_id = engine.id();
+        self.tabs.insert(engine_id, engine);
 
         // Switch the active tab.
+        if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
+            engine.set_visible(false);
+        }
         self.active_tab = engine_id;
 
         // Update tabs popup.
@@ -232,11 +605,154 @@ impl Window {
         }
         self.ui.set_uri("");
 
+        self.log_tab_opened(engine_id);
+        self.log_active_tab();
         self.unstall();
 
         Ok(engine_id)
     }
 
+    /// Add a tab to the window without loading it.
+    ///
+    /// The tab's engine is only created once the tab is activated.
+    pub fn add_background_tab(&mut self, input: &str) {
+        let tab = TabSession { uri: input_uri(input).into_owned(), ..Default::default() };
+        let engine = PlaceholderEngine::new(self.id, tab);
+        let engine_id = engine.id();
+        self.tabs.insert(engine_id, Box::new(engine));
+
+        // Update tabs popup.
+        self.overlay.tabs_mut().set_tabs(self.tabs.values(), self.active_tab);
+
+        self.log_tab_opened(engine_id);
+        self.log_tab_navigated(engine_id);
+    }
+
+    /// Get the window's state for session persistence.
+    pub fn session(&self) -> WindowSession {
+        let tabs = self
+            .tabs
+            .values()
+            .map(|engine| TabSession {
+                id: engine.id().raw(),
+                uri: engine.uri(),
+                title: engine.title(),
+                state: engine.session_state(),
+            })
+            .collect();
+        let active_tab = self.tabs.get_index_of(&self.active_tab).unwrap_or_default();
+        WindowSession { id: self.id.raw(), tabs, active_tab }
+    }
+
+    /// Restore tabs from a previous session.
+    ///
+    /// Only the active tab is loaded, all other tabs are loaded once they are
+    /// activated for the first time.
+    pub fn restore_session(&mut self, session: WindowSession) {
+        if session.tabs.is_empty() {
+            return;
+        }
+
+        // Reuse the initial tab's engine for the active tab.
+        for (engine_id, mut engine) in mem::take(&mut self.tabs) {
+            engine.set_visible(false);
+            self.engine_pool.push(engine);
+
+            let (window, tab) = (self.id.raw(), engine_id.raw());
+            self.queue.log_session_event(SessionEvent::TabClosed { window, tab });
+        }
+
+        for tab in session.tabs {
+            let engine = PlaceholderEngine::new(self.id, tab);
+            self.tabs.insert(engine.id(), Box::new(engine));
+        }
+
+        let active_index = session.active_tab.min(self.tabs.len() - 1);
+        let (&engine_id, _) = self.tabs.get_index(active_index).unwrap();
+        self.set_active_tab(engine_id);
+
+        // Update tabs popup.
+        self.overlay.tabs_mut().set_tabs(self.tabs.values(), self.active_tab);
+
+        self.set_keyboard_focus(KeyboardFocus::None);
+    }
+
+    /// Replace a tab's placeholder with a browser engine.
+    ///
+    /// Returns the ID of the tab's engine.
+    fn load_placeholder(&mut self, placeholder_id: EngineId) -> EngineId {
+        let index = match self.tabs.get_index_of(&placeholder_id) {
+            Some(index) => index,
+            None => return placeholder_id,
+        };
+
+        // Ignore tabs which are already loaded.
+        let (_, engine) = self.tabs.get_index_mut(index).unwrap();
+        if engine.as_any().downcast_mut::<PlaceholderEngine>().is_none() {
+            return placeholder_id;
+        }
+        let (uri, state) = (engine.uri(), engine.session_state());
+
+        let mut engine = match self.create_engine() {
+            Ok(engine) => engine,
+            Err(err) => {
+                error!("Could not load tab: {err}");
+                return placeholder_id;
+            },
+        };
+        engine.restore_session_state(&uri, &state);
+
+        // Put the new engine in the placeholder's position.
+        let engine_id = engine.id();
+        self.tabs.insert(engine_id, engine);
+        self.tabs.swap_indices(index, self.tabs.len() - 1);
+        self.tabs.pop();
+
+        // Update tabs popup.
+        self.overlay.tabs_mut().set_tabs(self.tabs.values(), self.active_tab);
+
+        self.log_tab_replaced(placeholder_id, engine_id);
+
+        engine_id
+    }
+
+    /// Record a new tab in the session journal.
+    fn log_tab_opened(&mut self, engine_id: EngineId) {
+        let index = match self.tabs.get_index_of(&engine_id) {
+            Some(index) => index as u32,
+            None => return,
+        };
+
+        let (window, tab) = (self.id.raw(), engine_id.raw());
+        self.queue.log_session_event(SessionEvent::TabOpened { window, tab, index });
+    }
+
+    /// Record a tab's new URI and history in the session journal.
+    fn log_tab_navigated(&mut self, engine_id: EngineId) {
+        let (uri, state) = match self.tabs.get(&engine_id) {
+            Some(engine) => (engine.uri(), engine.session_state()),
+            None => return,
+        };
+
+        let (window, tab) = (self.id.raw(), engine_id.raw());
+        self.queue.log_session_event(SessionEvent::TabNavigated { window, tab, uri, state });
+    }
+
+    /// Record the replacement of a tab's engine in the session journal.
+    fn log_tab_replaced(&mut self, old_engine_id: EngineId, engine_id: EngineId) {
+        self.log_tab_opened(engine_id);
+        self.log_tab_navigated(engine_id);
+
+        let (window, tab) = (self.id.raw(), old_engine_id.raw());
+        self.queue.log_session_event(SessionEvent::TabClosed { window, tab });
+    }
+
+    /// Record the active tab in the session journal.
+    fn log_active_tab(&mut self) {
+        let (window, tab) = (self.id.raw(), self.active_tab.raw());
+        self.queue.log_session_event(SessionEvent::ActiveTab { window, tab });
+    }
+
     /// Close a tabs.
     pub fn close_tab(&mut self, engine_id: EngineId) {
         // Remove engine and get the position it was in.
@@ -263,6 +779,9 @@ impl Window {
         // Force tabs UI redraw.
         self.dirty = true;
         self.unstall();
+
+        let (window, tab) = (self.id.raw(), engine_id.raw());
+        self.queue.log_session_event(SessionEvent::TabClosed { window, tab });
     }
 
     /// Get this window's active tab.
@@ -272,28 +791,44 @@ impl Window {
 
     /// Switch between tabs.
     pub fn set_active_tab(&mut self, engine_id: EngineId) {
-        self.active_tab = engine_id;
+        // Hide the previous tab, so it stops rendering.
+        if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
+            engine.set_visible(false);
+        }
+
+        // Load tabs restored from the previous session on first activation.
+        self.active_tab = self.load_placeholder(engine_id);
+
+        // Show the new tab, importing its latest frame.
+        let engine = self.tabs.get_mut(&self.active_tab).unwrap();
+        engine.set_visible(true);
 
         // Update URI bar.
-        let uri = self.tabs.get_mut(&self.active_tab).unwrap().uri();
+        let uri = engine.uri();
         self.ui.set_uri(&uri);
 
         // Update tabs popup.
         self.overlay.tabs_mut().set_active_tab(self.active_tab);
 
+        // Force attaching the new tab's buffer.
+        self.dirty = true;
+
+        self.log_active_tab();
         self.unstall();
     }
 
     /// Load a URI with the active tab.
     pub fn load_uri(&mut self, uri: String) {
-        // Perform search if URI is not a recognized URI.
-        let uri = match build_uri(uri.trim()) {
-            Some(uri) => uri,
-            None => Cow::Owned(format!("{SEARCH_URI}{uri}")),
-        };
-
-        if let Some(engine) = self.tabs.get(&self.active_tab) {
-            engine.load_uri(&uri);
+        let uri = input_uri(&uri);
+
+        // Swap in the prerendered engine, or load the URI in the active tab.
+        match self.take_prerender(&uri) {
+            Some(engine) => self.replace_active_tab(engine),
+            None => {
+                if let Some(engine) = self.tabs.get(&self.active_tab) {
+                    engine.load_uri(&uri);
+                }
+            },
         }
 
         // Close open option menus.
@@ -303,6 +838,29 @@ impl Window {
         self.set_keyboard_focus(KeyboardFocus::None);
     }
 
+    /// Handle compositor frame callbacks.
+    pub fn frame(&mut self, time: u32) {
+        self.frame_clock.frame(time);
+
+        // Resample touch input for the expected presentation time.
+        self.resample_time = self
+            .frame_clock
+            .next_presentation()
+            .map(|presentation| presentation.wrapping_sub(RESAMPLE_LATENCY));
+
+        self.draw();
+
+        self.resample_time = None;
+    }
+
+    /// Handle presentation feedback for the window's surfaces.
+    pub fn presented(&mut self, time: u32, refresh: u32) {
+        if let Some(clock_id) = self.presentation.as_ref().and_then(|p| p.clock_id()) {
+            self.frame_clock.set_clock(clock_id);
+        }
+        self.frame_clock.presented(time, refresh);
+    }
+
     /// Redraw the window.
     pub fn draw(&mut self) {
         // Ignore rendering before initial configure or after shutdown.
@@ -313,12 +871,39 @@ impl Window {
         // Mark window as stalled if no rendering is performed.
         self.stalled = true;
 
+        // Dispatch input coalesced since the last frame, keeping frames coming
+        // while input is active.
+        if self.flush_input() {
+            self.stalled = false;
+        }
+
         let mut text_input_state = TextInputChange::Disabled;
         let overlay_opaque = self.overlay.opaque();
 
         // Redraw the active browser engine.
         if !overlay_opaque {
-            let max_engine_size = Size::<f64>::from(self.engine_size()) * self.scale;
+            // Get engine's IME text_input state.
+            if self.text_input.is_some() && self.keyboard_focus == KeyboardFocus::Browser {
+                let engine = self.tabs.get_mut(&self.active_tab).unwrap();
+                text_input_state = engine.text_input_state();
+                match &text_input_state {
+                    TextInputChange::Dirty(state) => {
+                        self.engine_cursor_rect = Some(state.cursor_rect)
+                    },
+                    TextInputChange::Disabled => self.engine_cursor_rect = None,
+                    TextInputChange::Unchanged => (),
+                }
+            }
+
+            // Keep the text input cursor visible while the keyboard crops the engine.
+            let crop_changed = self.update_keyboard_crop_offset();
+            let crop = self.keyboard_crop;
+            if let (Some(crop), TextInputChange::Dirty(state)) = (crop, &mut text_input_state) {
+                state.cursor_rect.1 -= crop.offset.round() as i32;
+            }
+
+            let layout_size: Size<f64> = self.engine_layout_size().into();
+            let engine_size = self.engine_size();
             let engine = self.tabs.get_mut(&self.active_tab).unwrap();
 
             match engine.wl_buffer() {
@@ -326,16 +911,48 @@ impl Window {
                 Some(engine_buffer) => {
                     let buffer_size: Size<f64> = engine.buffer_size().into();
 
+                    // Update the pinch preview, stopping it once the engine has caught up.
+                    let mut pinch_dirty = false;
+                    if let Some(pinch) = &mut self.pinch {
+                        if engine.dirty() && !pinch.buffer_updated(engine.page_scale()) {
+                            self.pinch = None;
+                        } else {
+                            pinch_dirty = pinch.take_dirty();
+                        }
+                    }
+
+                    // Only show the part of the buffer not covered by the on-screen keyboard.
+                    let mut src_position = Position::new(0., crop.map_or(0., |crop| crop.offset));
+                    let mut src_size: Size<f64> = engine_size.into();
+
+                    // Scale and translate the last buffer to preview pinch gestures.
+                    if let Some(pinch) = &self.pinch {
+                        (src_position, src_size) =
+                            pinch.visible_area(src_position, src_size, layout_size);
+                    }
+
                     // Update browser's viewporter render size.
-                    let src_width = buffer_size.width.min(max_engine_size.width);
-                    let src_height = buffer_size.height.min(max_engine_size.height);
-                    self.engine_viewport.set_source(0., 0., src_width, src_height);
-                    let dst_width = (src_width / self.scale).round() as i32;
-                    let dst_height = (src_height / self.scale).round() as i32;
+                    //
+                    // The buffer is always scaled to fill the engine area, so outdated buffers
+                    // can still be shown while the engine is catching up with a resize.
+                    let scale_x = buffer_size.width / layout_size.width;
+                    let scale_y = buffer_size.height / layout_size.height;
+                    let src_position =
+                        Position::new(src_position.x * scale_x, src_position.y * scale_y);
+                    let src_size = Size::new(src_size.width * scale_x, src_size.height * scale_y);
+                    self.engine_viewport.set_source(
+                        src_position.x,
+                        src_position.y,
+                        src_size.width,
+                        src_size.height,
+                    );
+                    self.engine_source = Some((src_position, src_size));
+                    let dst_width = engine_size.width as i32;
+                    let dst_height = engine_size.height as i32;
                     self.engine_viewport.set_destination(dst_width, dst_height);
 
                     // Render buffer if it requires a redraw.
-                    if engine.dirty() || self.dirty {
+                    if engine.dirty() || self.dirty || crop_changed || pinch_dirty {
                         // Attach engine buffer to primary surface.
                         self.engine_surface.attach(Some(engine_buffer), 0, 0);
                         self.engine_surface.damage(0, 0, dst_width, dst_height);
@@ -347,18 +964,25 @@ impl Window {
                         self.stalled = false;
                     }
                 },
-                // Clear attached surface if we've switched to an engine that
-                // doesn't have a buffer yet.
+                // Fill the engine area with the background color if we've switched to an
+                // engine that doesn't have a buffer yet.
                 None => {
-                    self.engine_surface.attach(None, 0, 0);
+                    if self.engine_bg_buffer.is_some() {
+                        let dst_width = engine_size.width as i32;
+                        let dst_height = engine_size.height as i32;
+                        self.engine_viewport.set_source(-1., -1., -1., -1.);
+                        self.engine_viewport.set_destination(dst_width, dst_height);
+                    }
+
+                    self.engine_surface.attach(self.engine_bg_buffer.as_ref(), 0, 0);
                     self.engine_surface.commit();
                 },
             }
+        }
 
-            // Get engine's IME text_input state.
-            if self.text_input.is_some() && self.keyboard_focus == KeyboardFocus::Browser {
-                text_input_state = engine.text_input_state();
-            }
+        // Move hole-punched video along with the engine viewport.
+        if self.update_video_geometry() {
+            self.video_surface.commit();
         }
 
         // Draw UI.
@@ -372,6 +996,12 @@ impl Window {
             text_input_state = self.ui.text_input_state();
         }
 
+        // Provide the latest engine frames for the tab overview's thumbnails.
+        let tabs = self.overlay.tabs_mut();
+        if tabs.visible() {
+            tabs.set_thumbnail_images(self.tabs.values());
+        }
+
         // Draw overlay surface.
         let overlay_rendered = self.overlay.draw();
         self.stalled &= !overlay_rendered;
@@ -389,6 +1019,11 @@ impl Window {
         let surface = self.xdg.wl_surface();
         if !self.stalled {
             surface.frame(&self.wayland_queue, surface.clone());
+
+            // Track presentation times for touch resampling.
+            if let Some(presentation) = &self.presentation {
+                presentation.feedback(&self.wayland_queue, surface);
+            }
         }
 
         // Submit the new frame.
@@ -436,15 +1071,34 @@ impl Window {
 
             return;
         }
-        self.fullscreen = is_fullscreen;
-        self.size = size;
+        let old_engine_height = self.engine_size().height;
+        let fullscreen_changed = mem::replace(&mut self.fullscreen, is_fullscreen) != is_fullscreen;
+        let old_size = mem::replace(&mut self.size, size);
+
+        // Allow the compositor to skip everything below the engine surface.
+        self.update_engine_region();
+
+        // Crop engines instead of resizing them for on-screen keyboard changes.
+        let keyboard_resize = was_done && !fullscreen_changed && old_size.width == size.width;
+        let keep_engine_size = self.update_keyboard_crop(keyboard_resize, old_engine_height);
 
         // Resize window's browser engines.
-        let engine_size = self.engine_size();
-        for engine in self.tabs.values_mut() {
-            engine.set_size(engine_size);
+        //
+        // Interactive resizes are debounced, to avoid relayouts for every intermediate
+        // size. The last engine buffer is scaled to fit the window in the meantime.
+        if keep_engine_size {
+            if let Some(timeout) = self.engine_resize_timeout.take() {
+                timeout.destroy();
+            }
+        } else if !was_done || fullscreen_changed {
+            self.resize_engines();
+        } else {
+            self.schedule_engine_resize();
         }
 
+        // Force engine surface update with the new viewport destination.
+        self.dirty = true;
+
         // Resize UI element surface.
         if !size_unchanged {
             self.overlay.set_size(self.size);
@@ -467,6 +1121,232 @@ impl Window {
         self.unstall();
     }
 
+    /// Update engine cropping for on-screen keyboard height changes.
+    ///
+    /// While a text input is focused, height changes are assumed to be caused
+    /// by the on-screen keyboard. Instead of relayouting every engine, the
+    /// visible part of the engine buffer is cropped through its viewport.
+    ///
+    /// Returns `true` if the engines can keep their current size.
+    fn update_keyboard_crop(&mut self, keyboard_resize: bool, old_engine_height: u32) -> bool {
+        let engine_height = self.engine_size().height;
+        let layout_height = self.keyboard_crop.map_or(old_engine_height, |crop| crop.engine_height);
+        let text_input_active =
+            self.keyboard_focus == KeyboardFocus::Browser && self.engine_cursor_rect.is_some();
+
+        // Crop engines while the keyboard is covering parts of them.
+        if keyboard_resize
+            && engine_height < layout_height
+            && (text_input_active || self.keyboard_crop.is_some())
+        {
+            let offset = self.keyboard_crop.map_or(0., |crop| crop.offset);
+            self.keyboard_crop = Some(KeyboardCrop { engine_height: layout_height, offset });
+            return true;
+        }
+
+        // Engines are already at the correct size once the keyboard is hidden.
+        let crop = self.keyboard_crop.take();
+        keyboard_resize && crop.map_or(false, |crop| crop.engine_height == engine_height)
+    }
+
+    /// Scroll the cropped engine area to keep the text input cursor visible.
+    ///
+    /// Returns `true` if the visible engine area has changed.
+    fn update_keyboard_crop_offset(&mut self) -> bool {
+        let visible_height = self.engine_size().height as f64;
+        let crop = match &mut self.keyboard_crop {
+            Some(crop) => crop,
+            None => return false,
+        };
+        let old_offset = crop.offset;
+
+        // Scroll just enough to reveal the cursor.
+        if let Some((_, y, _, height)) = self.engine_cursor_rect {
+            let (top, bottom) = (y as f64, (y + height) as f64);
+            if top < crop.offset {
+                crop.offset = top;
+            } else if bottom > crop.offset + visible_height {
+                crop.offset = bottom - visible_height;
+            }
+        }
+
+        let max_offset = (crop.engine_height as f64 - visible_height).max(0.);
+        crop.offset = crop.offset.clamp(0., max_offset);
+
+        crop.offset != old_offset
+    }
+
+    /// Convert an engine surface position to engine coordinates.
+    fn engine_position(&self, mut position: Position<f64>) -> Position<f64> {
+        if let Some(crop) = self.keyboard_crop {
+            position.y += crop.offset;
+        }
+        position
+    }
+
+    /// Size the browser engines are laid out at.
+    ///
+    /// This is bigger than the visible engine area while the on-screen
+    /// keyboard is cropping the engines.
+    fn engine_layout_size(&self) -> Size {
+        let engine_size = self.engine_size();
+        match self.keyboard_crop {
+            Some(crop) => Size::new(engine_size.width, crop.engine_height),
+            None => engine_size,
+        }
+    }
+
+    /// Resize engines once the window size has settled.
+    fn schedule_engine_resize(&mut self) {
+        if let Some(timeout) = self.engine_resize_timeout.take() {
+            timeout.destroy();
+        }
+
+        let mut queue = self.queue.handle();
+        let window_id = self.id;
+        let source =
+            source::timeout_source_new(RESIZE_DEBOUNCE, None, Priority::DEFAULT, move || {
+                queue.resize_engines(window_id);
+                ControlFlow::Break
+            });
+        source.attach(None);
+        self.engine_resize_timeout = Some(source);
+    }
+
+    /// Update all engines to the current engine size.
+    pub fn resize_engines(&mut self) {
+        if let Some(timeout) = self.engine_resize_timeout.take() {
+            timeout.destroy();
+        }
+
+        let engine_size = self.engine_layout_size();
+        for engine in self.engines_mut() {
+            engine.set_size(engine_size);
+        }
+    }
+
+    /// Mark the engine area as opaque.
+    ///
+    /// Engine buffers are opaque unless they contain a hole for a video plane,
+    /// which allows the compositor to skip blending the surfaces below.
+    fn update_engine_region(&self) {
+        if self.video_plane.is_some() {
+            self.engine_surface.set_opaque_region(None);
+        } else if let Ok(region) = Region::new(&self.compositor) {
+            let engine_size: Size<i32> = self.engine_size().into();
+            region.add(0, 0, engine_size.width, engine_size.height);
+            self.engine_surface.set_opaque_region(Some(region.wl_region()));
+        }
+    }
+
+    /// Show a hole-punched video frame.
+    ///
+    /// The frame is attached to a desynchronized subsurface, so new frames are
+    /// presented without redrawing the window.
+    pub fn set_video_frame(&mut self, frame: VideoFrame) {
+        let video_dmabuf = match &self.video_dmabuf {
+            Some(video_dmabuf) => video_dmabuf,
+            None => return,
+        };
+
+        let buffer = match video_dmabuf.create_buffer(&frame.buffer, VideoBufferData::default()) {
+            Some(buffer) => buffer,
+            None => {
+                warn!("Compositor does not support hole-punched video frames");
+                return;
+            },
+        };
+
+        let geometry = self.video_plane.and_then(|plane| plane.geometry);
+        let previous = self.video_plane.replace(VideoPlane {
+            video_id: frame.video_id,
+            position: frame.position,
+            size: frame.buffer.size,
+            geometry,
+        });
+        let geometry_changed = self.update_video_geometry();
+
+        // Only attach frames which are at least partially visible.
+        if self.video_plane.map_or(false, |plane| plane.geometry.is_some()) {
+            let size = frame.buffer.size;
+
+            // Keep the frame alive until the compositor is done with it.
+            if let Some(data) = buffer.data::<VideoBufferData>() {
+                data.set_frame(frame);
+            }
+
+            self.video_surface.attach(Some(&buffer), 0, 0);
+            self.video_surface.damage_buffer(0, 0, size.width as i32, size.height as i32);
+        } else {
+            buffer.destroy();
+        }
+        self.video_surface.commit();
+
+        // Subsurface position and opaque region are applied with the next redraw.
+        if previous.is_none() {
+            self.update_engine_region();
+            self.dirty = true;
+        }
+        if previous.is_none() || geometry_changed {
+            self.unstall();
+        }
+    }
+
+    /// Remove a video's plane.
+    pub fn end_video(&mut self, video_id: u32) {
+        if self.video_plane.map_or(true, |plane| plane.video_id != video_id) {
+            return;
+        }
+        self.video_plane = None;
+
+        self.video_surface.attach(None, 0, 0);
+        self.video_surface.commit();
+
+        // Restore the engine's opaque region.
+        self.update_engine_region();
+        self.dirty = true;
+        self.unstall();
+    }
+
+    /// Map the video plane through the engine viewport.
+    ///
+    /// This keeps the video aligned with its hole in the engine buffer while
+    /// the engine is cropped, scaled, or previewing a pinch gesture. Videos
+    /// outside the visible engine area are hidden until their next frame.
+    ///
+    /// Returns `true` if the video surface requires a commit.
+    fn update_video_geometry(&mut self) -> bool {
+        let engine_size = self.engine_size();
+        let (plane, engine_source) = match (&mut self.video_plane, self.engine_source) {
+            (Some(plane), Some(engine_source)) => (plane, engine_source),
+            _ => return false,
+        };
+
+        let geometry = VideoGeometry::new(plane.position, plane.size, engine_source, engine_size);
+        if geometry == plane.geometry {
+            return false;
+        }
+        plane.geometry = geometry;
+
+        match geometry {
+            Some(geometry) => {
+                let (position, size) = (geometry.position, geometry.size);
+                let (src_position, src_size) = (geometry.src_position, geometry.src_size);
+                self.video_subsurface.set_position(position.x, position.y);
+                self.video_viewport.set_source(
+                    src_position.x,
+                    src_position.y,
+                    src_size.width,
+                    src_size.height,
+                );
+                self.video_viewport.set_destination(size.width, size.height);
+            },
+            None => self.video_surface.attach(None, 0, 0),
+        }
+
+        true
+    }
+
     /// Update surface scale.
     pub fn set_scale(&mut self, scale: f64) {
         // Update window scale.
@@ -476,7 +1356,7 @@ impl Window {
         self.scale = scale;
 
         // Resize window's browser engines.
-        for engine in self.tabs.values_mut() {
+        for engine in self.engines_mut() {
             engine.set_scale(scale);
         }
 
@@ -536,13 +1416,15 @@ impl Window {
         modifiers: Modifiers,
     ) {
         if &self.engine_surface == surface {
-            // Forward event to browser engine.
+            // Ensure popups are closed when scrolling.
             if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
-                // Ensure popups are closed when scrolling.
                 engine.close_option_menu(None);
-
-                engine.pointer_axis(time, position, horizontal, vertical, modifiers);
             }
+
+            // Merge scroll events until the next frame.
+            let position = self.engine_position(position);
+            self.pending_input.add_pointer_axis(time, position, horizontal, vertical, modifiers);
+            self.unstall();
         }
     }
 
@@ -559,7 +1441,11 @@ impl Window {
         if &self.engine_surface == surface {
             self.update_keyboard_focus_surface(surface);
 
+            // Ensure ordering with pending motion and scroll events.
+            self.flush_input();
+
             // Use real pointer events for the browser engine.
+            let position = self.engine_position(position);
             if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
                 engine.pointer_button(time, position, button, state, modifiers);
             }
@@ -587,10 +1473,10 @@ impl Window {
         modifiers: Modifiers,
     ) {
         if &self.engine_surface == surface {
-            // Use real pointer events for the browser engine.
-            if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
-                engine.pointer_motion(time, position, modifiers);
-            }
+            // Only keep the latest motion until the next frame.
+            let position = self.engine_position(position);
+            self.pending_input.pointer_motion = Some((time, position, modifiers));
+            self.unstall();
         } else {
             // Emulate touch for non-engine purposes.
             self.touch_motion(surface, time, -1, position, modifiers);
@@ -606,7 +1492,17 @@ impl Window {
         position: Position<f64>,
         modifiers: Modifiers,
     ) {
-        self.touch_points.insert(id, position);
+        self.frame_clock.input(time);
+
+        if &self.engine_surface == surface {
+            // Ensure ordering with pending motion events, which must not include
+            // the new touch point yet.
+            self.flush_input();
+
+            self.touch_points.insert(id, time, self.engine_position(position));
+        } else {
+            self.touch_points.insert(id, time, position);
+        }
 
         // Update the surface receiving keyboard focus.
         self.update_keyboard_focus_surface(surface);
@@ -619,6 +1515,16 @@ impl Window {
 
                 engine.touch_down(&self.touch_points, time, id, modifiers);
             }
+
+            // Preview two finger pinches, ending the preview for other gestures.
+            let previewable =
+                self.tabs.get(&self.active_tab).map_or(false, |engine| engine.pinch_previewable());
+            match &self.pinch {
+                Some(pinch) if pinch.active() => self.end_pinch(),
+                Some(_) => (),
+                None if previewable => self.pinch = Pinch::new(&self.touch_points),
+                None => (),
+            }
         } else if self.ui.surface() == surface {
             // Close all dropdowns when clicking on the UI.
             if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
@@ -640,6 +1546,14 @@ impl Window {
     pub fn touch_up(&mut self, surface: &WlSurface, time: u32, id: i32, modifiers: Modifiers) {
         // Forward events to corresponding surface.
         if &self.engine_surface == surface {
+            // Submit the pinch's final state before releasing its touch points.
+            if self.pinch.map_or(false, |pinch| pinch.active() && pinch.contains(id)) {
+                self.end_pinch();
+            }
+
+            // Ensure ordering with pending motion events.
+            self.flush_input();
+
             if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
                 engine.touch_up(&self.touch_points, time, id, modifiers);
             }
@@ -655,7 +1569,7 @@ impl Window {
         }
 
         // Remove touch point from all future events.
-        self.touch_points.remove(&id);
+        self.touch_points.remove(id);
     }
 
     /// Handle touch motion events.
@@ -667,13 +1581,35 @@ impl Window {
         position: Position<f64>,
         modifiers: Modifiers,
     ) {
-        self.touch_points.insert(id, position);
+        self.frame_clock.input(time);
 
-        // Forward events to corresponding surface.
         if &self.engine_surface == surface {
-            if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
-                engine.touch_motion(&self.touch_points, time, id, modifiers);
+            self.touch_points.insert(id, time, self.engine_position(position));
+        } else {
+            self.touch_points.insert(id, time, position);
+        }
+
+        // Stop previewing once the page reports that it handles the pinch itself.
+        if self.pinch.map_or(false, |pinch| pinch.active()) {
+            let engine = self.tabs.get(&self.active_tab);
+            if !engine.map_or(false, |engine| engine.pinch_previewable()) {
+                self.cancel_pinch();
             }
+        }
+
+        // Forward events to corresponding surface.
+        if &self.engine_surface == surface && self.pinch.map_or(false, |pinch| pinch.active()) {
+            // Preview pinches, instead of having the engine render every step.
+            if let Some(pinch) = &mut self.pinch {
+                pinch.update(&self.touch_points);
+            }
+            self.pinch_motion = Some((time, id, modifiers));
+            self.schedule_pinch_timeout(PINCH_COMMIT_DELAY);
+            self.unstall();
+        } else if &self.engine_surface == surface {
+            // Merge engine motion until the next frame.
+            self.pending_input.touch_motion = Some((time, id, modifiers));
+            self.unstall();
         } else if self.ui.surface() == surface {
             self.ui.touch_motion(time, id, position, modifiers);
         } else if self.overlay.surface() == surface {
@@ -686,6 +1622,117 @@ impl Window {
         }
     }
 
+    /// Submit the pinch preview's latest state to the engine.
+    fn commit_pinch(&mut self) {
+        let (pinch, (time, id, modifiers)) = match (&mut self.pinch, self.pinch_motion.take()) {
+            (Some(pinch), Some(motion)) => (pinch, motion),
+            _ => return,
+        };
+
+        if let Some(engine) = self.tabs.get_mut(&self.active_tab) {
+            pinch.commit(engine.page_scale());
+            engine.touch_motion(&self.touch_points, time, id, modifiers);
+        }
+    }
+
+    /// Submit the pinch's final state and wait for the engine to render it.
+    fn end_pinch(&mut self) {
+        self.commit_pinch();
+
+        let page_scale = self.tabs.get(&self.active_tab).map_or(1., |engine| engine.page_scale());
+        if let Some(pinch) = &mut self.pinch {
+            pinch.end(page_scale);
+        }
+
+        // Stop the preview if the engine never renders the final state.
+        self.schedule_pinch_timeout(PINCH_PREVIEW_TIMEOUT);
+    }
+
+    /// Stop the pinch preview, letting the engine handle the gesture.
+    fn cancel_pinch(&mut self) {
+        if let Some(timeout) = self.pinch_timeout.take() {
+            timeout.destroy();
+        }
+        self.pinch_motion = None;
+        self.pinch = None;
+        self.dirty = true;
+    }
+
+    /// Schedule the next pinch preview timeout.
+    fn schedule_pinch_timeout(&mut self, delay: Duration) {
+        if let Some(timeout) = self.pinch_timeout.take() {
+            timeout.destroy();
+        }
+
+        let mut queue = self.queue.handle();
+        let window_id = self.id;
+        let source = source::timeout_source_new(delay, None, Priority::DEFAULT, move || {
+            queue.pinch_timeout(window_id);
+            ControlFlow::Break
+        });
+        source.attach(None);
+        self.pinch_timeout = Some(source);
+    }
+
+    /// Handle pinch preview timeouts.
+    pub fn pinch_timeout(&mut self) {
+        self.pinch_timeout = None;
+
+        match self.pinch {
+            // Let the engine render paused gestures.
+            Some(pinch) if pinch.active() => self.commit_pinch(),
+            // Stop previewing finished gestures.
+            Some(_) => {
+                self.pinch = None;
+                self.dirty = true;
+                self.unstall();
+            },
+            None => (),
+        }
+    }
+
+    /// Dispatch coalesced input events to the active engine.
+    ///
+    /// Returns `true` if any events were dispatched.
+    fn flush_input(&mut self) -> bool {
+        let pending_input = mem::take(&mut self.pending_input);
+        if pending_input.is_empty() {
+            return false;
+        }
+
+        let engine = match self.tabs.get_mut(&self.active_tab) {
+            Some(engine) => engine,
+            None => return true,
+        };
+
+        if let Some((time, position, modifiers)) = pending_input.pointer_motion {
+            engine.pointer_motion(time, position, modifiers);
+        }
+
+        if let Some(axis) = pending_input.pointer_axis {
+            engine.pointer_axis(
+                axis.time,
+                axis.position,
+                axis.horizontal,
+                axis.vertical,
+                axis.modifiers,
+            );
+        }
+
+        if let Some((time, id, modifiers)) = pending_input.touch_motion {
+            match self.resample_time {
+                Some(resample_time) => {
+                    // Keep the original event time, so timestamps stay monotonic.
+                    let touch_points = self.touch_points.resampled(resample_time);
+                    engine.touch_motion(&touch_points, time, id, modifiers);
+                },
+                None => engine.touch_motion(&self.touch_points, time, id, modifiers),
+            }
+        }
+
+        true
+    }
+
     /// Handle IME focus.
     pub fn text_input_enter(&mut self, text_input: ZwpTextInputV3) {
         self.text_input = Some(text_input.into());
@@ -750,6 +1797,11 @@ impl Window {
 
     /// Update an engine's URI.
     pub fn set_engine_uri(&mut self, history: &History, engine_id: EngineId, uri: String) {
+        // Ignore hidden engines until the user actually visits the page.
+        if !self.tabs.contains_key(&engine_id) {
+            return;
+        }
+
         // Update UI if the URI change is for the active tab.
         if engine_id == self.active_tab {
             self.ui.set_uri(&uri);
@@ -765,6 +1817,8 @@ impl Window {
 
         // Increment URI visit count for history.
         history.visit(uri);
+
+        self.log_tab_navigated(engine_id);
     }
 
     /// Update an engine's title.
@@ -775,7 +1829,10 @@ impl Window {
         // Update title of current URI for history.
         if let Some(engine) = self.tabs.get(&engine_id) {
             let uri = engine.uri();
-            history.set_title(&uri, title);
+            history.set_title(&uri, title.clone());
+
+            let (window, tab) = (self.id.raw(), engine_id.raw());
+            self.queue.log_session_event(SessionEvent::TabTitle { window, tab, title });
         }
     }
 
@@ -823,6 +1880,9 @@ impl Window {
             self.close_option_menu(menu_id);
         }
 
+        // Stage prerender for the most relevant match.
+        self.stage_prerender(matches.last());
+
         // Skip new menu creation without matches.
         if matches.is_empty() {
             return;
@@ -856,6 +1916,125 @@ impl Window {
         }
     }
 
+    /// Stage prerendering of a URI bar suggestion.
+    ///
+    /// The prerender is only started once the top match has been stable for
+    /// [`PRERENDER_DELAY`].
+    fn stage_prerender(&mut self, top_match: Option<&HistoryMatch>) {
+        if !self.config.prerender.enabled {
+            return;
+        }
+
+        // Only prerender frequently visited pages.
+        let min_views = self.config.prerender.min_views;
+        let uri = match top_match.filter(|m| m.views >= min_views) {
+            Some(top_match) => &top_match.uri,
+            None => {
+                self.discard_prerender();
+                return;
+            },
+        };
+
+        // Keep existing prerender if the top match is unchanged.
+        if same_uri(uri, &self.prerender.uri) {
+            return;
+        }
+        self.discard_prerender();
+        self.prerender.uri = uri.clone();
+
+        // Start prerender once the match has been stable for a while.
+        let mut queue = self.queue.handle();
+        let window_id = self.id;
+        let source =
+            source::timeout_source_new(PRERENDER_DELAY, None, Priority::DEFAULT, move || {
+                queue.start_prerender(window_id);
+                ControlFlow::Break
+            });
+        source.attach(None);
+        self.prerender.timeout = Some(source);
+    }
+
+    /// Start loading the staged prerender URI in a hidden engine.
+    pub fn start_prerender(&mut self) {
+        self.prerender.timeout = None;
+
+        if self.prerender.uri.is_empty() || self.prerender.engine.is_some() {
+            return;
+        }
+
+        // Avoid prerendering when memory is scarce.
+        let min_memory_mb = self.config.prerender.min_memory_mb;
+        if memory::available_mb().map_or(true, |available| available < min_memory_mb) {
+            info!("Skipping prerender due to low memory");
+            return;
+        }
+
+        let engine = match self.create_engine() {
+            Ok(engine) => engine,
+            Err(err) => {
+                error!("Could not create prerender engine: {err}");
+                return;
+            },
+        };
+        engine.load_uri(&self.prerender.uri);
+
+        self.prerender.engine = Some(engine);
+    }
+
+    /// Take the prerendered engine if it matches the URI.
+    ///
+    /// Prerenders for any other URI are discarded.
+    fn take_prerender(&mut self, uri: &str) -> Option<Box<dyn Engine>> {
+        let prerender = mem::take(&mut self.prerender);
+        prerender.cancel_timeout();
+        prerender.engine.filter(|_| same_uri(uri, &prerender.uri))
+    }
+
+    /// Stop any pending or active prerender.
+    fn discard_prerender(&mut self) {
+        mem::take(&mut self.prerender).cancel_timeout();
+    }
+
+    /// Replace the active tab's engine.
+    fn replace_active_tab(&mut self, mut engine: Box<dyn Engine>) {
+        let index = match self.tabs.get_index_of(&self.active_tab) {
+            Some(index) => index,
+            None => return,
+        };
+
+        // Put the new engine in the old engine's position.
+        let old_engine_id = self.active_tab;
+        let engine_id = engine.id();
+        engine.set_visible(true);
+        let uri = engine.uri();
+        let title = engine.title();
+        self.tabs.insert(engine_id, engine);
+        self.tabs.swap_indices(index, self.tabs.len() - 1);
+        self.tabs.pop();
+        self.active_tab = engine_id;
+
+        // Record the visit, since prerender navigation is excluded from history.
+        self.history.visit(uri.clone());
+        if !title.is_empty() {
+            self.history.set_title(&uri, title.clone());
+        }
+
+        self.log_tab_replaced(old_engine_id, engine_id);
+        if !title.is_empty() {
+            let (window, tab) = (self.id.raw(), engine_id.raw());
+            self.queue.log_session_event(SessionEvent::TabTitle { window, tab, title });
+        }
+        self.log_active_tab();
+
+        // Update URI bar and tabs popup.
+        self.ui.set_uri(&uri);
+        self.overlay.tabs_mut().set_tabs(self.tabs.values(), self.active_tab);
+
+        // Force redraw with the new engine's buffer.
+        self.dirty = true;
+        self.unstall();
+    }
+
     /// Handle engine fullscreen requests.
     pub fn request_fullscreen(&mut self, engine_id: EngineId, enable: bool) {
         // Ignore fullscreen requests for background engines.
@@ -864,9 +2043,14 @@ impl Window {
         }
 
         // Request fullscreen mode from compositor.
+        //
+        // Fullscreen video is moved above the engine surface, so the compositor
+        // can put it on a hardware plane without blending the page on top.
         if enable {
+            self.video_subsurface.place_above(&self.engine_surface);
             self.xdg().set_fullscreen(None);
         } else {
+            self.video_subsurface.place_below(&self.engine_surface);
             self.xdg().unset_fullscreen();
         }
 
@@ -915,6 +2099,9 @@ impl Window {
         // Clear UI focus.
         if focus != KeyboardFocus::Ui {
             self.ui.clear_keyboard_focus();
+
+            // Prerenders are only useful while the URI bar is being edited.
+            self.discard_prerender();
         }
 
         // Clear engine focus.
@@ -926,6 +2113,23 @@ impl Window {
     }
 }
 
+/// Hidden engine loading a URI bar suggestion ahead of time.
+#[derive(Default)]
+struct Prerender {
+    engine: Option<Box<dyn Engine>>,
+    timeout: Option<Source>,
+    uri: String,
+}
+
+impl Prerender {
+    /// Cancel the pending prerender start.
+    fn cancel_timeout(&self) {
+        if let Some(timeout) = &self.timeout {
+            timeout.destroy();
+        }
+    }
+}
+
 /// Unique identifier for one window.
 #[derive(Debug, Copy, Clone, PartialEq, Eq, PartialOrd, Ord, Hash)]
 pub struct WindowId(usize);
@@ -935,6 +2139,11 @@ impl WindowId {
         static NEXT_WINDOW_ID: AtomicUsize = AtomicUsize::new(0);
         Self(NEXT_WINDOW_ID.fetch_add(1, Ordering::Relaxed))
     }
+
+    /// Get the ID's numeric value.
+    pub fn raw(&self) -> u64 {
+        self.0 as u64
+    }
 }
 
 impl Default for WindowId {
@@ -1024,6 +2233,90 @@ impl TextInput {
     }
 }
 
+/// Hole-punched video shown below the engine.
+#[derive(Copy, Clone, Debug)]
+struct VideoPlane {
+    video_id: u32,
+    /// Frame position in engine buffer pixels.
+    position: Position,
+    /// Frame size in engine buffer pixels.
+    size: Size,
+    /// Geometry last applied to the video surface.
+    geometry: Option<VideoGeometry>,
+}
+
+/// Visible area of a video frame on the engine surface.
+#[derive(PartialEq, Copy, Clone, Debug)]
+struct VideoGeometry {
+    /// Logical position on the engine surface.
+    position: Position,
+    /// Logical size on the engine surface.
+    size: Size<i32>,
+    /// Visible frame area in video buffer pixels.
+    src_position: Position<f64>,
+    src_size: Size<f64>,
+}
+
+impl VideoGeometry {
+    /// Map a video frame through the engine viewport.
+    ///
+    /// The `engine_source` is the engine viewport's source rectangle in engine
+    /// buffer pixels, which is scaled to fill the logical `engine_size`.
+    ///
+    /// Returns `None` if the frame is outside the visible engine area.
+    fn new(
+        position: Position,
+        size: Size,
+        engine_source: (Position<f64>, Size<f64>),
+        engine_size: Size,
+    ) -> Option<Self> {
+        let (src_position, src_size) = engine_source;
+        if src_size.width <= 0. || src_size.height <= 0. {
+            return None;
+        }
+
+        let scale_x = engine_size.width as f64 / src_size.width;
+        let scale_y = engine_size.height as f64 / src_size.height;
+        let x = (position.x as f64 - src_position.x) * scale_x;
+        let y = (position.y as f64 - src_position.y) * scale_y;
+        let width = size.width as f64 * scale_x;
+        let height = size.height as f64 * scale_y;
+
+        // Clip the frame to the engine area, so it never covers the UI.
+        let left = x.max(0.).round();
+        let top = y.max(0.).round();
+        let right = (x + width).min(engine_size.width as f64).round();
+        let bottom = (y + height).min(engine_size.height as f64).round();
+        if right <= left || bottom <= top {
+            return None;
+        }
+
+        let src_x = ((left - x) / scale_x).clamp(0., size.width as f64);
+        let src_y = ((top - y) / scale_y).clamp(0., size.height as f64);
+        let src_width = ((right - left) / scale_x).min(size.width as f64 - src_x);
+        let src_height = ((bottom - top) / scale_y).min(size.height as f64 - src_y);
+        if src_width <= 0. || src_height <= 0. {
+            return None;
+        }
+
+        Some(Self {
+            position: Position::new(left as i32, top as i32),
+            size: Size::new((right - left) as i32, (bottom - top) as i32),
+            src_position: Position::new(src_x, src_y),
+            src_size: Size::new(src_width, src_height),
+        })
+    }
+}
+
+/// Engine cropping while the on-screen keyboard is visible.
+#[derive(Copy, Clone, Debug)]
+struct KeyboardCrop {
+    /// Logical height the engines are laid out at.
+    engine_height: u32,
+    /// Logical vertical offset of the visible engine area.
+    offset: f64,
+}
+
 /// IME text_input state.
 #[derive(Clone, PartialEq, Eq, Debug)]
 pub struct TextInputState {
@@ -1090,6 +2383,16 @@ pub enum TextInputChange {
     Dirty(TextInputState),
 }
 
+/// Convert URI bar input to a URI.
+///
+/// Input which is not a recognized URI is turned into a search query.
+fn input_uri(input: &str) -> Cow<'_, str> {
+    match build_uri(input.trim()) {
+        Some(uri) => uri,
+        None => Cow::Owned(format!("{SEARCH_URI}{input}")),
+    }
+}
+
 #[allow(rustdoc::bare_urls)]
 /// Extract HTTP URI from uri bar input.
 ///
@@ -1173,6 +2476,29 @@ fn build_uri(mut input: &str) -> Option<Cow<'_, str>> {
     }
 }
 
+/// Check if two URIs refer to the same page, ignoring trailing slashes.
+fn same_uri(a: &str, b: &str) -> bool {
+    !a.is_empty() && a.trim_end_matches('/') == b.trim_end_matches('/')
+}
+
+/// Periodically release pooled engines while memory is low.
+///
+/// Pool refills already respect the available memory, but pooled engines
+/// would otherwise keep their idle web processes alive under memory pressure.
+pub fn schedule_engine_pool_trim(mut queue: StQueueHandle<State>) {
+    source::timeout_add_seconds_local_full(POOL_TRIM_INTERVAL, Priority::LOW, move || {
+        queue.trim_engine_pools();
+        ControlFlow::Continue
+    });
+}
+
+/// Get the number of pooled engines permitted by the available memory.
+fn engine_pool_size() -> usize {
+    let available_mb = memory::available_mb().unwrap_or_default();
+    let pool_size = (available_mb / POOL_ENGINE_MEMORY_MB).saturating_sub(1) as usize;
+    pool_size.min(MAX_ENGINE_POOL_SIZE)
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -1202,4 +2528,37 @@ mod tests {
         assert_eq!(build_uri("example:/").as_deref(), None);
         assert_eq!(build_uri("xxx:123:456").as_deref(), None);
     }
+
+    #[test]
+    fn video_geometry() {
+        let engine_size = Size::new(100, 50);
+        let position = Position::new(20, 20);
+        let size = Size::new(40, 20);
+
+        // Buffer at twice the logical size.
+        let source = (Position::new(0., 0.), Size::new(200., 100.));
+        let geometry = VideoGeometry::new(position, size, source, engine_size).unwrap();
+        assert_eq!(geometry.position, Position::new(10, 10));
+        assert_eq!(geometry.size, Size::new(20, 10));
+        assert_eq!(geometry.src_position, Position::new(0., 0.));
+        assert_eq!(geometry.src_size, Size::new(40., 20.));
+
+        // Cropped by the on-screen keyboard.
+        let source = (Position::new(0., 30.), Size::new(200., 100.));
+        let geometry = VideoGeometry::new(position, size, source, engine_size).unwrap();
+        assert_eq!(geometry.position, Position::new(10, 0));
+        assert_eq!(geometry.size, Size::new(20, 5));
+        assert_eq!(geometry.src_position, Position::new(0., 10.));
+        assert_eq!(geometry.src_size, Size::new(40., 10.));
+
+        // Zoomed in by a pinch preview.
+        let source = (Position::new(20., 20.), Size::new(100., 50.));
+        let geometry = VideoGeometry::new(position, size, source, engine_size).unwrap();
+        assert_eq!(geometry.position, Position::new(0, 0));
+        assert_eq!(geometry.size, Size::new(40, 20));
+
+        // Outside the visible area.
+        let source = (Position::new(0., 40.), Size::new(200., 100.));
+        assert_eq!(VideoGeometry::new(position, size, source, engine_size), None);
+    }
 }
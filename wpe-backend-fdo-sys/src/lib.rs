@@ -633,3 +633,67 @@ extern "C" {
         arg2: *mut wpe_fdo_shm_exported_buffer,
     );
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct wpe_video_plane_display_dmabuf_export {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct wpe_video_plane_display_dmabuf_receiver {
+    pub handle_dmabuf: ::std::option::Option<
+        unsafe extern "C" fn(
+            data: *mut ::std::os::raw::c_void,
+            dmabuf_export: *mut wpe_video_plane_display_dmabuf_export,
+            id: u32,
+            fd: ::std::os::raw::c_int,
+            x: i32,
+            y: i32,
+            width: i32,
+            height: i32,
+            stride: u32,
+        ),
+    >,
+    pub end_of_stream:
+        ::std::option::Option<unsafe extern "C" fn(data: *mut ::std::os::raw::c_void, id: u32)>,
+    pub _wpe_reserved0: ::std::option::Option<unsafe extern "C" fn()>,
+    pub _wpe_reserved1: ::std::option::Option<unsafe extern "C" fn()>,
+    pub _wpe_reserved2: ::std::option::Option<unsafe extern "C" fn()>,
+}
+#[test]
+fn bindgen_test_layout_wpe_video_plane_display_dmabuf_receiver() {
+    const UNINIT: ::std::mem::MaybeUninit<wpe_video_plane_display_dmabuf_receiver> =
+        ::std::mem::MaybeUninit::uninit();
+    let ptr = UNINIT.as_ptr();
+    assert_eq!(
+        ::std::mem::size_of::<wpe_video_plane_display_dmabuf_receiver>(),
+        40usize,
+        concat!("Size of: ", stringify!(wpe_video_plane_display_dmabuf_receiver))
+    );
+    assert_eq!(
+        ::std::mem::align_of::<wpe_video_plane_display_dmabuf_receiver>(),
+        8usize,
+        concat!("Alignment of ", stringify!(wpe_video_plane_display_dmabuf_receiver))
+    );
+    assert_eq!(
+        unsafe { ::std::ptr::addr_of!((*ptr).end_of_stream) as usize - ptr as usize },
+        8usize,
+        concat!(
+            "Offset of field: ",
+            stringify!(wpe_video_plane_display_dmabuf_receiver),
+            "::",
+            stringify!(end_of_stream)
+        )
+    );
+}
+extern "C" {
+    pub fn wpe_video_plane_display_dmabuf_register_receiver(
+        arg1: *const wpe_video_plane_display_dmabuf_receiver,
+        arg2: *mut ::std::os::raw::c_void,
+    );
+}
+extern "C" {
+    pub fn wpe_video_plane_display_dmabuf_export_release(
+        arg1: *mut wpe_video_plane_display_dmabuf_export,
+    );
+}
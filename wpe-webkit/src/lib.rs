@@ -8,6 +8,7 @@ pub use cookie_manager::*;
 pub use input_method_context::*;
 pub use network_session::*;
 pub use user_content_filter_store::*;
+pub use version::*;
 pub use website_data_manager::*;
 
 mod authentication_request;
@@ -19,5 +20,6 @@ mod input_method_context;
 mod network_session;
 mod rectangle;
 mod user_content_filter_store;
+mod version;
 mod web_view_backend;
 mod website_data_manager;
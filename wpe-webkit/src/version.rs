@@ -0,0 +1,17 @@
+/// Get the major version of the WebKit library in use.
+#[doc(alias = "webkit_get_major_version")]
+pub fn major_version() -> u32 {
+    unsafe { ffi::webkit_get_major_version() }
+}
+
+/// Get the minor version of the WebKit library in use.
+#[doc(alias = "webkit_get_minor_version")]
+pub fn minor_version() -> u32 {
+    unsafe { ffi::webkit_get_minor_version() }
+}
+
+/// Get the micro version of the WebKit library in use.
+#[doc(alias = "webkit_get_micro_version")]
+pub fn micro_version() -> u32 {
+    unsafe { ffi::webkit_get_micro_version() }
+}